@@ -0,0 +1,79 @@
+#include "allocation_counter.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local size_t allocation_count = 0;
+thread_local size_t allowed_allocation_count = SIZE_MAX;
+
+//    ,   
+bool TakeAllocation() {
+    if (allowed_allocation_count == 0) {
+        return false;
+    }
+    if (allowed_allocation_count != SIZE_MAX) {
+        --allowed_allocation_count;
+    }
+    ++allocation_count;
+    return true;
+}
+
+}  // namespace
+
+size_t GetThreadAllocationCount() {
+    return allocation_count;
+}
+
+void SetThreadAllocationLimit(size_t count) {
+    allowed_allocation_count = count;
+}
+
+//    .     malloc  free,
+//          
+void* operator new(size_t size) {
+    if (TakeAllocation()) {
+        if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+            return pointer;
+        }
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return TakeAllocation() ? std::malloc(size == 0 ? 1 : size) : nullptr;
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, [[maybe_unused]] size_t size) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, [[maybe_unused]] size_t size) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+
+//  new  delete   allocation_counter.cpp    .
+//          new  free
+//        
+
+//          
+size_t GetThreadAllocationCount();
+
+//  count       new  std::bad_alloc,
+//  nothrow-  nullptr. SIZE_MAX  
+void SetThreadAllocationLimit(size_t count);
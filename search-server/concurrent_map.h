@@ -1,22 +1,26 @@
+#pragma once
+#include <algorithm>
 #include <cstdlib>
+#include <functional>
 #include <map>
 #include <mutex>
-#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
-using namespace std::string_literals;
-
-template <typename Key, typename Value>
+// Hash map split into independently locked buckets. Every operation locks
+// only the bucket of its key, batch operations lock each touched bucket once.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class ConcurrentMap {
 private:
-    struct Bucket {
+    // Buckets sit on separate cache lines so that neighbouring mutexes don't share one
+    struct alignas(64) Bucket {
         std::mutex mutex;
-        std::map<Key, Value> map;
+        std::unordered_map<Key, Value, Hash> map;
     };
 
 public:
-    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"s);
-
     struct Access {
         std::lock_guard<std::mutex> guard;
         Value& ref_to_value;
@@ -27,29 +31,118 @@ public:
         }
     };
 
+    // A few buckets per hardware thread keep the chance of two threads meeting on one low
+    ConcurrentMap()
+        : ConcurrentMap(4 * std::max(1u, std::thread::hardware_concurrency())) {
+    }
+
     explicit ConcurrentMap(size_t bucket_count)
-        : buckets_(bucket_count) {
+        : buckets_(std::max<size_t>(1, bucket_count)) {
     }
 
+    // The bucket stays locked while the returned Access is alive
     Access operator[](const Key& key) {
-        auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-        return { key, bucket };
+        return { key, GetBucket(key) };
+    }
+
+    // Returns false if the key was already present, the value is left untouched then
+    template <typename... Args>
+    bool Emplace(const Key& key, Args&&... args) {
+        Bucket& bucket = GetBucket(key);
+        std::lock_guard guard(bucket.mutex);
+        return bucket.map.try_emplace(key, std::forward<Args>(args)...).second;
+    }
+
+    // Calls function(Value&) under the bucket lock, a missing value is default constructed first
+    template <typename Function>
+    void Update(const Key& key, Function function) {
+        Bucket& bucket = GetBucket(key);
+        std::lock_guard guard(bucket.mutex);
+        function(bucket.map[key]);
+    }
+
+    // Calls function(const Value&) under the bucket lock if the key is present
+    template <typename Function>
+    bool Visit(const Key& key, Function function) {
+        Bucket& bucket = GetBucket(key);
+        std::lock_guard guard(bucket.mutex);
+        const auto it = bucket.map.find(key);
+        if (it == bucket.map.end()) {
+            return false;
+        }
+        function(static_cast<const Value&>(it->second));
+        return true;
+    }
+
+    bool Erase(const Key& key) {
+        Bucket& bucket = GetBucket(key);
+        std::lock_guard guard(bucket.mutex);
+        return bucket.map.erase(key) > 0;
+    }
+
+    // Applies function(Value&, item.second) to the value of every item.first
+    template <typename Items, typename Function>
+    void UpdateBatch(const Items& items, Function function) {
+        ForEachBucketGroup(items, [](const auto& item) -> const Key& { return item.first; },
+            [&function](auto& map, const auto& item) {
+                function(map[item.first], item.second);
+            });
+    }
+
+    template <typename Keys>
+    void EraseBatch(const Keys& keys) {
+        ForEachBucketGroup(keys, [](const Key& key) -> const Key& { return key; },
+            [](auto& map, const Key& key) {
+                map.erase(key);
+            });
+    }
+
+    size_t Size() {
+        size_t size = 0;
+        for (auto& [mutex, map] : buckets_) {
+            std::lock_guard guard(mutex);
+            size += map.size();
+        }
+        return size;
     }
 
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
         for (auto& [mutex, map] : buckets_) {
-            std::lock_guard g(mutex);
+            std::lock_guard guard(mutex);
             result.insert(map.begin(), map.end());
         }
         return result;
     }
 
-    void Erase(const Key& key) {
-        auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-        bucket.map.erase(key);
-    }
-
 private:
     std::vector<Bucket> buckets_;
+
+    size_t GetBucketIndex(const Key& key) const {
+        return Hash{}(key) % buckets_.size();
+    }
+
+    Bucket& GetBucket(const Key& key) {
+        return buckets_[GetBucketIndex(key)];
+    }
+
+    template <typename Items, typename GetKey, typename Apply>
+    void ForEachBucketGroup(const Items& items, GetKey get_key, Apply apply) {
+        std::vector<std::pair<size_t, const typename Items::value_type*>> grouped;
+        grouped.reserve(items.size());
+        for (const auto& item : items) {
+            grouped.push_back({ GetBucketIndex(get_key(item)), &item });
+        }
+        std::stable_sort(grouped.begin(), grouped.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+            });
+        for (auto it = grouped.begin(); it != grouped.end();) {
+            Bucket& bucket = buckets_[it->first];
+            std::lock_guard guard(bucket.mutex);
+            const size_t bucket_index = it->first;
+            for (; it != grouped.end() && it->first == bucket_index; ++it) {
+                apply(bucket.map, *it->second);
+            }
+        }
+    }
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "concurrent_search_server.h"
+
+#include <chrono>
+#include <thread>
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string_view stop_words_text)
+    : replicas_{ SearchServer(stop_words_text), SearchServer(stop_words_text) }
+{
+}
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string& stop_words_text)
+    : replicas_{ SearchServer(stop_words_text), SearchServer(stop_words_text) }
+{
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    Write([&](SearchServer& server) {
+        server.AddDocument(document_id, document, status, ratings);
+        });
+}
+
+void ConcurrentSearchServer::AddDocuments(const std::vector<SearchServer::NewDocument>& documents) {
+    Write([&documents](SearchServer& server) {
+        server.AddDocuments(documents);
+        });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    Write([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+        });
+}
+
+void ConcurrentSearchServer::PurgeRemovedDocuments() {
+    Write([](SearchServer& server) {
+        server.PurgeRemovedDocuments();
+        });
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return Read([](const SearchServer& server) {
+        return server.GetDocumentCount();
+        });
+}
+
+ConcurrentSearchServer::ReadGuard::ReadGuard(ReadIndicator& indicator)
+    : indicator_(indicator)
+{
+    indicator_.reader_count.fetch_add(1);
+}
+
+ConcurrentSearchServer::ReadGuard::~ReadGuard() {
+    indicator_.reader_count.fetch_sub(1);
+}
+
+void ConcurrentSearchServer::RepairReplica() {
+    if (damaged_replica_ < 0) {
+        return;
+    }
+    // If the copy fails too, the replica stays damaged until the next change
+    replicas_[damaged_replica_] = replicas_[1 - damaged_replica_].Clone();
+    damaged_replica_ = -1;
+}
+
+void ConcurrentSearchServer::WaitForReaders(int version) const {
+    // Reads are short, so a reader running on another core leaves soon. A reader that was preempted
+    // needs the core back, and yielding to other readers would only let them take whole time slices
+    for (int attempt = 0; read_indicators_[version].reader_count.load() != 0; ++attempt) {
+        if (attempt >= SPIN_ATTEMPT_COUNT) {
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "search_server.h"
+
+// Search server that answers queries while documents are added and removed. Two replicas
+// of the server are kept (the Left-Right scheme): readers use one of them while the writer
+// changes the other, then readers are switched over and the change is repeated on the first
+// replica once its last reader leaves. Readers never wait, writers wait for each other and
+// for the readers of the replica they change. The price is twice the memory and every change made twice.
+// Writes are about 24 times slower than under one std::mutex (2011 against 48599 writes/s with
+// three readers, main --bench), as each one is applied twice and waits out the readers of both replicas
+class ConcurrentSearchServer {
+public:
+    template <typename StringContainer>
+    explicit ConcurrentSearchServer(const StringContainer& stop_words);
+
+    explicit ConcurrentSearchServer(const std::string_view stop_words_text);
+
+    explicit ConcurrentSearchServer(const std::string& stop_words_text);
+
+    // An invalid document throws before readers can see any change
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void AddDocuments(const std::vector<SearchServer::NewDocument>& documents);
+
+    void RemoveDocument(int document_id);
+
+    void PurgeRemovedDocuments();
+
+    // Takes the arguments of SearchServer::FindTopDocuments
+    template <typename... Args>
+    std::vector<Document> FindTopDocuments(const Args&... args) const;
+
+    // Takes the arguments of SearchServer::MatchDocument. The words are copied,
+    // as the next change may move the words of the replica
+    template <typename... Args>
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const Args&... args) const;
+
+    int GetDocumentCount() const;
+
+    // Calls reader(const SearchServer&) and returns its result. The replica doesn't change
+    // until the call returns, so several reads inside it see the same documents.
+    // Views into the replica, such as matched words, must not outlive the call
+    template <typename Reader>
+    auto Read(Reader reader) const;
+
+private:
+    // Checks of the reader count before the writer starts sleeping between them
+    inline static constexpr int SPIN_ATTEMPT_COUNT = 1000;
+
+    // Counters of different versions sit on separate cache lines
+    struct alignas(64) ReadIndicator {
+        std::atomic<int64_t> reader_count{ 0 };
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(ReadIndicator& indicator);
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ~ReadGuard();
+
+    private:
+        ReadIndicator& indicator_;
+    };
+
+    SearchServer replicas_[2];
+    // Replica that new readers go to
+    std::atomic<int> read_replica_{ 0 };
+    // A reader registers in the indicator of the current version. The writer switches the version
+    // between waiting for one indicator and the other, so both waits together see every reader
+    // that may still use the old replica, and the new readers don't keep the writer waiting
+    mutable ReadIndicator read_indicators_[2];
+    std::atomic<int> version_{ 0 };
+    std::mutex write_mutex_;
+    // Replica that a failed change may have left half done, -1 if there is none.
+    // Readers never use it, it is copied from the other replica before the next change
+    int damaged_replica_ = -1;
+
+    // Applies writer(SearchServer&) to both replicas. SearchServer checks arguments before changing
+    // anything, so std::invalid_argument leaves the replicas as they were. If another exception comes
+    // from the first replica, readers keep the unchanged one and the exception is passed on. If it comes
+    // from the second, readers already see the change, so the second replica is copied from the first
+    template <typename Writer>
+    void Write(Writer writer);
+
+    // Copies the damaged replica from the other one, if there is a damaged replica
+    void RepairReplica();
+
+    void WaitForReaders(int version) const;
+};
+
+template <typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer& stop_words)
+    : replicas_{ SearchServer(stop_words), SearchServer(stop_words) }
+{
+}
+
+template <typename... Args>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(const Args&... args) const {
+    return Read([&args...](const SearchServer& server) {
+        return server.FindTopDocuments(args...);
+        });
+}
+
+template <typename... Args>
+std::tuple<std::vector<std::string>, DocumentStatus> ConcurrentSearchServer::MatchDocument(const Args&... args) const {
+    return Read([&args...](const SearchServer& server) {
+        const auto [words, status] = server.MatchDocument(args...);
+        return std::tuple<std::vector<std::string>, DocumentStatus>(std::vector<std::string>(words.begin(), words.end()), status);
+        });
+}
+
+template <typename Reader>
+auto ConcurrentSearchServer::Read(Reader reader) const {
+    ReadGuard guard(read_indicators_[version_.load()]);
+    return reader(replicas_[read_replica_.load()]);
+}
+
+template <typename Writer>
+void ConcurrentSearchServer::Write(Writer writer) {
+    std::lock_guard<std::mutex> guard(write_mutex_);
+    RepairReplica();
+    const int read_replica = read_replica_.load();
+    try {
+        writer(replicas_[1 - read_replica]);
+    }
+    catch (const std::invalid_argument&) {
+        throw;
+    }
+    catch (...) {
+        damaged_replica_ = 1 - read_replica;
+        throw;
+    }
+    read_replica_.store(1 - read_replica);
+    const int version = version_.load();
+    WaitForReaders(1 - version);
+    version_.store(1 - version);
+    WaitForReaders(version);
+    try {
+        writer(replicas_[read_replica]);
+    }
+    catch (...) {
+        damaged_replica_ = read_replica;
+        RepairReplica();
+    }
+}
\ No newline at end of file
@@ -8,6 +8,8 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+static const size_t DOCUMENT_STATUS_COUNT = 4;
+
 struct Document {
     Document();
 
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "term_dictionary.h"
+
+// Spreads the bits of the value over all 64 bits (the splitmix64 finalizer)
+inline uint64_t MixBits(uint64_t hash) {
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+// Mixes the term id with the seed into 64 well spread bits
+inline uint64_t HashTermId(TermId term_id, uint64_t seed) {
+    return MixBits((term_id + seed) * 0x9e3779b97f4a7c15ULL);
+}
+
+// Hash of a set of term ids that doesn't depend on their order: the sums of two independent
+// hashes of every term. Different sets get equal fingerprints with a probability of about 2^-128
+struct DocumentFingerprint {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    void AddTerm(TermId term_id) {
+        low += HashTermId(term_id, 0x243f6a8885a308d3ULL);
+        high += HashTermId(term_id, 0x13198a2e03707344ULL);
+    }
+
+    bool operator==(const DocumentFingerprint& other) const {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=(const DocumentFingerprint& other) const {
+        return !(*this == other);
+    }
+};
+
+struct DocumentFingerprintHasher {
+    size_t operator()(const DocumentFingerprint& fingerprint) const {
+        return static_cast<size_t>(fingerprint.low);
+    }
+};
\ No newline at end of file
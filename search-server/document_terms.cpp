@@ -0,0 +1,116 @@
+#include "document_terms.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+const DocumentTerm* FindTerm(const DocumentTerm* first, const DocumentTerm* last, TermId term_id) {
+    const DocumentTerm* const it = std::lower_bound(first, last, term_id, [](const DocumentTerm& term, TermId id) {
+        return term.term_id < id;
+        });
+    return it != last && it->term_id == term_id ? it : nullptr;
+}
+
+}  // namespace
+
+DocumentTermIds::DocumentTermIds(const DocumentTerm* first, const DocumentTerm* last)
+    : first_(first)
+    , last_(last)
+{
+}
+
+DocumentTermIds::Iterator DocumentTermIds::begin() const {
+    return Iterator(first_);
+}
+
+DocumentTermIds::Iterator DocumentTermIds::end() const {
+    return Iterator(last_);
+}
+
+size_t DocumentTermIds::size() const {
+    return last_ - first_;
+}
+
+bool DocumentTermIds::empty() const {
+    return first_ == last_;
+}
+
+bool DocumentTermIds::Contains(TermId term_id) const {
+    return FindTerm(first_, last_, term_id) != nullptr;
+}
+
+bool DocumentTermIds::operator==(const DocumentTermIds& other) const {
+    return std::equal(begin(), end(), other.begin(), other.end());
+}
+
+bool DocumentTermIds::operator!=(const DocumentTermIds& other) const {
+    return !(*this == other);
+}
+
+WordFrequencies::WordFrequencies(const InvertedIndex& index, const DocumentTerm* first, const DocumentTerm* last, double inverse_word_count)
+    : index_(&index)
+    , first_(first)
+    , last_(last)
+    , inverse_word_count_(inverse_word_count)
+{
+}
+
+WordFrequencies::Iterator WordFrequencies::begin() const {
+    return Iterator(this, first_);
+}
+
+WordFrequencies::Iterator WordFrequencies::end() const {
+    return Iterator(this, last_);
+}
+
+size_t WordFrequencies::size() const {
+    return last_ - first_;
+}
+
+bool WordFrequencies::empty() const {
+    return first_ == last_;
+}
+
+size_t WordFrequencies::count(std::string_view word) const {
+    return Find(word) != nullptr ? 1 : 0;
+}
+
+double WordFrequencies::at(std::string_view word) const {
+    const DocumentTerm* const term = Find(word);
+    if (term == nullptr) {
+        throw std::out_of_range("No word \"" + std::string(word) + "\" in the document");
+    }
+    return GetTermFreq(*term);
+}
+
+bool WordFrequencies::operator==(const WordFrequencies& other) const {
+    if (size() != other.size()) {
+        return false;
+    }
+    // Servers may number the same words differently, so words are looked up by text
+    for (const DocumentTerm* term = first_; term != last_; ++term) {
+        const DocumentTerm* const other_term = other.Find(index_->GetWord(term->term_id));
+        if (other_term == nullptr || GetTermFreq(*term) != other.GetTermFreq(*other_term)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WordFrequencies::operator!=(const WordFrequencies& other) const {
+    return !(*this == other);
+}
+
+double WordFrequencies::GetTermFreq(const DocumentTerm& term) const {
+    return term.count * inverse_word_count_;
+}
+
+const DocumentTerm* WordFrequencies::Find(std::string_view word) const {
+    if (first_ == last_) {
+        return nullptr;
+    }
+    const std::optional<TermId> term_id = index_->FindTermId(word);
+    return term_id ? FindTerm(first_, last_, *term_id) : nullptr;
+}
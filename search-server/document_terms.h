@@ -0,0 +1,167 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+#include "inverted_index.h"
+#include "term_dictionary.h"
+
+// A distinct word of a document and the number of its occurrences. The words of a document
+// are kept as one array of these sorted by term id, the forward index of the server
+struct DocumentTerm {
+    TermId term_id;
+    uint32_t count;
+};
+
+// Term ids of a document in increasing order, read right from its term array
+class DocumentTermIds {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TermId;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TermId*;
+        using reference = const TermId&;
+
+        Iterator() = default;
+
+        explicit Iterator(const DocumentTerm* term)
+            : term_(term)
+        {
+        }
+
+        reference operator*() const {
+            return term_->term_id;
+        }
+
+        pointer operator->() const {
+            return &term_->term_id;
+        }
+
+        Iterator& operator++() {
+            ++term_;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            return Iterator(term_++);
+        }
+
+        bool operator==(const Iterator& other) const {
+            return term_ == other.term_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return term_ != other.term_;
+        }
+
+    private:
+        const DocumentTerm* term_ = nullptr;
+    };
+
+    DocumentTermIds() = default;
+
+    DocumentTermIds(const DocumentTerm* first, const DocumentTerm* last);
+
+    Iterator begin() const;
+
+    Iterator end() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // Binary search over the sorted terms
+    bool Contains(TermId term_id) const;
+
+    bool operator==(const DocumentTermIds& other) const;
+
+    bool operator!=(const DocumentTermIds& other) const;
+
+private:
+    const DocumentTerm* first_ = nullptr;
+    const DocumentTerm* last_ = nullptr;
+};
+
+// Term frequencies of a document by word, computed from its term array on access. Words are
+// visited in term id order. The view is valid until the document or the server is changed
+class WordFrequencies {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator() = default;
+
+        Iterator(const WordFrequencies* frequencies, const DocumentTerm* term)
+            : frequencies_(frequencies)
+            , term_(term)
+        {
+        }
+
+        value_type operator*() const {
+            return { frequencies_->index_->GetWord(term_->term_id), frequencies_->GetTermFreq(*term_) };
+        }
+
+        Iterator& operator++() {
+            ++term_;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            return Iterator(frequencies_, term_++);
+        }
+
+        bool operator==(const Iterator& other) const {
+            return term_ == other.term_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return term_ != other.term_;
+        }
+
+    private:
+        const WordFrequencies* frequencies_ = nullptr;
+        const DocumentTerm* term_ = nullptr;
+    };
+
+    WordFrequencies() = default;
+
+    WordFrequencies(const InvertedIndex& index, const DocumentTerm* first, const DocumentTerm* last, double inverse_word_count);
+
+    Iterator begin() const;
+
+    Iterator end() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    size_t count(std::string_view word) const;
+
+    // Throws std::out_of_range if the document doesn't have the word
+    double at(std::string_view word) const;
+
+    // Equal views have the same words with the same frequencies, whatever their term ids
+    bool operator==(const WordFrequencies& other) const;
+
+    bool operator!=(const WordFrequencies& other) const;
+
+private:
+    const InvertedIndex* index_ = nullptr;
+    const DocumentTerm* first_ = nullptr;
+    const DocumentTerm* last_ = nullptr;
+    double inverse_word_count_ = 0.0;
+
+    double GetTermFreq(const DocumentTerm& term) const;
+
+    // nullptr if the document doesn't have the word
+    const DocumentTerm* Find(std::string_view word) const;
+};
@@ -0,0 +1,273 @@
+#include "inverted_index.h"
+
+TermId InvertedIndex::AddWord(std::string_view word) {
+    const TermId term_id = dictionary_.Intern(word);
+    if (terms_.size() <= term_id) {
+        terms_.resize(term_id + 1);
+    }
+    return term_id;
+}
+
+void InvertedIndex::AddPosting(TermId term_id, int document_id, uint32_t document_ordinal, uint32_t count, double term_freq) {
+    Term& term = terms_[term_id];
+    std::vector<Posting>& buffered = term.buffered_postings;
+    if (buffered.empty()) {
+        buffer_term_ids_.push_back(term_id);
+    }
+    // Documents mostly arrive with growing ids, so the common case is an append
+    if (buffered.empty() || buffered.back().document_id < document_id) {
+        buffered.push_back({ document_id, document_ordinal, count });
+    }
+    else {
+        buffered.insert(std::upper_bound(buffered.begin(), buffered.end(), document_id, [](int id, const Posting& posting) {
+            return id < posting.document_id;
+            }), { document_id, document_ordinal, count });
+    }
+    ++term.posting_count;
+    ++buffer_posting_count_;
+    term.max_term_freq = std::max(term.max_term_freq, term_freq);
+    term.log_document_freq = std::log(static_cast<double>(term.GetDocumentCount()));
+}
+
+void InvertedIndex::SealBufferIfFull() {
+    if (buffer_posting_count_ >= BUFFER_POSTING_COUNT) {
+        SealBuffer();
+    }
+}
+
+void InvertedIndex::MarkDocumentRemoved(TermId term_id) {
+    Term& term = terms_[term_id];
+    ++term.removed_document_count;
+    term.log_document_freq = std::log(static_cast<double>(term.GetDocumentCount()));
+}
+
+void InvertedIndex::CompactWords() {
+    dictionary_.CompactWords();
+}
+
+std::optional<TermId> InvertedIndex::FindTermId(std::string_view word) const {
+    return dictionary_.Find(word);
+}
+
+std::string_view InvertedIndex::GetWord(TermId term_id) const {
+    return dictionary_.GetWord(term_id);
+}
+
+const InvertedIndex::Term& InvertedIndex::GetTerm(TermId term_id) const {
+    return terms_[term_id];
+}
+
+size_t InvertedIndex::GetTermIdCount() const {
+    return terms_.size();
+}
+
+size_t InvertedIndex::GetSegmentCount() const {
+    return segments_.size() + 1;
+}
+
+PostingView InvertedIndex::GetSegmentPostings(const Term& term, size_t segment) const {
+    if (segment == segments_.size()) {
+        const std::vector<Posting>& buffered = term.buffered_postings;
+        return PostingView(nullptr, 0, nullptr, buffered.data(), buffered.size(), buffered.size());
+    }
+    const uint32_t segment_id = segments_[segment].id;
+    const auto run = std::partition_point(term.runs.begin(), term.runs.end(), [segment_id](const Run& run) {
+        return run.segment_id < segment_id;
+        });
+    return run != term.runs.end() && run->segment_id == segment_id ? run->GetPostings() : PostingView();
+}
+
+void InvertedIndex::SaveSnapshot(SnapshotWriter& writer, const OrdinalBitmap& live_ordinals) const {
+    const size_t term_count = dictionary_.GetIdCount();
+    std::vector<std::string_view> words(term_count);
+    std::vector<uint64_t> block_counts(term_count);
+    std::vector<double> max_term_freqs(term_count);
+    std::vector<PostingBlock> blocks;
+    std::vector<uint8_t> data;
+    std::vector<Posting> postings;
+    for (TermId term_id = 0; term_id < term_count; ++term_id) {
+        // Segments and uncompressed postings are packed together, so a loaded index is one segment of blocks
+        postings.clear();
+        terms_[term_id].ForEachPosting([&](const Posting& posting) {
+            if (live_ordinals.Test(posting.document_ordinal)) {
+                postings.push_back(posting);
+            }
+            });
+        std::sort(postings.begin(), postings.end(), [](const Posting& lhs, const Posting& rhs) {
+            return lhs.document_id < rhs.document_id;
+            });
+        words[term_id] = postings.empty() ? std::string_view() : dictionary_.GetWord(term_id);
+        const size_t first_block = blocks.size();
+        EncodePostingBlocks(postings.data(), postings.data() + postings.size(), blocks, data);
+        block_counts[term_id] = blocks.size() - first_block;
+        max_term_freqs[term_id] = terms_[term_id].max_term_freq;
+    }
+    data.resize(data.size() + POSTING_DATA_PADDING, 0);
+    writer.WriteStrings(words);
+    writer.WriteArray(block_counts);
+    writer.WriteArray(max_term_freqs);
+    writer.WriteArray(blocks);
+    writer.WriteArray(data);
+}
+
+void InvertedIndex::LoadSnapshot(SnapshotReader& reader, std::shared_ptr<const MappedFile> file) {
+    const std::vector<std::string_view> words = reader.ReadStrings();
+    const SnapshotArray<uint64_t> block_counts = reader.ReadArray<uint64_t>();
+    const SnapshotArray<double> max_term_freqs = reader.ReadArray<double>();
+    const SnapshotArray<PostingBlock> blocks = reader.ReadArray<PostingBlock>();
+    const SnapshotArray<uint8_t> data = reader.ReadArray<uint8_t>();
+    if (block_counts.size != words.size() || max_term_freqs.size != words.size() || data.size < POSTING_DATA_PADDING) {
+        throw std::runtime_error("  ");
+    }
+    for (const PostingBlock& block : blocks) {
+        if (!IsValidPostingBlock(block, data.size - POSTING_DATA_PADDING)) {
+            throw std::runtime_error("  ");
+        }
+    }
+    dictionary_.LoadWords(words);
+    terms_.assign(words.size(), Term());
+    segments_.assign(1, Segment{ 0, 0, {} });
+    next_segment_id_ = 1;
+    buffer_term_ids_.clear();
+    buffer_posting_count_ = 0;
+    const PostingBlock* first = blocks.begin();
+    for (TermId term_id = 0; term_id < words.size(); ++term_id) {
+        const uint64_t block_count = block_counts.data[term_id];
+        if (block_count > static_cast<size_t>(blocks.end() - first)) {
+            throw std::runtime_error("  ");
+        }
+        size_t posting_count = 0;
+        for (const PostingBlock* block = first; block != first + block_count; ++block) {
+            posting_count += block->size;
+        }
+        Term& term = terms_[term_id];
+        term.max_term_freq = max_term_freqs.data[term_id];
+        if (posting_count > 0) {
+            term.runs.push_back({ 0, PostingList(), PostingView(first, block_count, data.data, nullptr, 0, posting_count) });
+            term.posting_count = posting_count;
+            term.log_document_freq = std::log(static_cast<double>(posting_count));
+            segments_[0].posting_count += posting_count;
+            segments_[0].term_ids.push_back(term_id);
+        }
+        first += block_count;
+    }
+    if (segments_[0].posting_count == 0) {
+        segments_.clear();
+    }
+    snapshot_file_ = std::move(file);
+}
+
+void InvertedIndex::CheckSnapshotOrdinals(size_t ordinal_count) const {
+    for (const Term& term : terms_) {
+        for (const Run& run : term.runs) {
+            const PostingView postings = run.GetPostings();
+            for (size_t i = 0; i < postings.GetBlockCount(); ++i) {
+                if (!AreBlockOrdinalsBelow(postings.GetBlocks()[i], postings.GetData(), ordinal_count)) {
+                    throw std::runtime_error("  ");
+                }
+            }
+        }
+    }
+}
+
+PostingView InvertedIndex::Run::GetPostings() const {
+    return mapped_postings.empty() ? postings.GetView() : mapped_postings;
+}
+
+size_t InvertedIndex::Term::GetDocumentCount() const {
+    return posting_count - removed_document_count;
+}
+
+PostingList& InvertedIndex::GetOwnedPostings(Run& run) {
+    if (!run.mapped_postings.empty()) {
+        run.postings = PostingList(run.mapped_postings.Decode());
+        run.mapped_postings = {};
+    }
+    return run.postings;
+}
+
+void InvertedIndex::SealBuffer() {
+    Segment segment{ next_segment_id_++, buffer_posting_count_, std::move(buffer_term_ids_) };
+    buffer_term_ids_.clear();
+    buffer_posting_count_ = 0;
+    std::sort(segment.term_ids.begin(), segment.term_ids.end());
+    segment.term_ids.erase(std::unique(segment.term_ids.begin(), segment.term_ids.end()), segment.term_ids.end());
+    for (const TermId term_id : segment.term_ids) {
+        Term& term = terms_[term_id];
+        if (!term.buffered_postings.empty()) {
+            term.runs.push_back({ segment.id, PostingList(std::move(term.buffered_postings)), PostingView() });
+            term.buffered_postings = {};
+        }
+    }
+    segments_.push_back(std::move(segment));
+    while (segments_.size() >= 2 && segments_[segments_.size() - 2].posting_count <= 2 * segments_.back().posting_count) {
+        MergeLastSegments();
+    }
+}
+
+void InvertedIndex::MergeLastSegments() {
+    Segment newer = std::move(segments_.back());
+    segments_.pop_back();
+    Segment& older = segments_.back();
+    for (const TermId term_id : newer.term_ids) {
+        // Runs of the two newest segments are the last ones of a term
+        std::vector<Run>& runs = terms_[term_id].runs;
+        if (runs.empty() || runs.back().segment_id != newer.id) {
+            continue;
+        }
+        if (runs.size() >= 2 && runs[runs.size() - 2].segment_id == older.id) {
+            MergeRuns(runs[runs.size() - 2], runs.back());
+            runs.pop_back();
+        }
+        else {
+            runs.back().segment_id = older.id;
+        }
+    }
+    std::vector<TermId> term_ids;
+    term_ids.reserve(older.term_ids.size() + newer.term_ids.size());
+    std::set_union(older.term_ids.begin(), older.term_ids.end(), newer.term_ids.begin(), newer.term_ids.end(), std::back_inserter(term_ids));
+    older.term_ids = std::move(term_ids);
+    older.posting_count += newer.posting_count;
+}
+
+void InvertedIndex::MergeRuns(Run& older, const Run& newer) {
+    const PostingView older_postings = older.GetPostings();
+    const PostingView newer_postings = newer.GetPostings();
+    // Segments of documents added in id order don't overlap, their blocks are copied as they are
+    if (older_postings.GetLastDocumentId() < newer_postings.GetFirstDocumentId()) {
+        GetOwnedPostings(older).Append(newer_postings);
+        return;
+    }
+    const std::vector<Posting> older_list = older_postings.Decode();
+    const std::vector<Posting> newer_list = newer_postings.Decode();
+    std::vector<Posting> postings;
+    postings.reserve(older_list.size() + newer_list.size());
+    std::merge(older_list.begin(), older_list.end(), newer_list.begin(), newer_list.end(), std::back_inserter(postings), [](const Posting& lhs, const Posting& rhs) {
+        return lhs.document_id < rhs.document_id;
+        });
+    older.postings = PostingList(std::move(postings));
+    older.mapped_postings = {};
+}
+
+size_t InvertedIndex::FindSegment(uint32_t segment_id) const {
+    return std::partition_point(segments_.begin(), segments_.end(), [segment_id](const Segment& segment) {
+        return segment.id < segment_id;
+        }) - segments_.begin();
+}
+
+std::vector<size_t> InvertedIndex::CountSegmentPostings(const std::vector<TermId>& term_ids) const {
+    std::vector<size_t> posting_counts(GetSegmentCount(), 0);
+    for (const TermId term_id : term_ids) {
+        const Term& term = terms_[term_id];
+        for (const Run& run : term.runs) {
+            posting_counts[FindSegment(run.segment_id)] += run.GetPostings().size();
+        }
+        posting_counts.back() += term.buffered_postings.size();
+    }
+    return posting_counts;
+}
+
+void InvertedIndex::ReleaseTerm(TermId term_id) {
+    terms_[term_id] = Term();
+    dictionary_.Release(term_id);
+}
\ No newline at end of file
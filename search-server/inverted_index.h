@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ordinal_bitmap.h"
+#include "posting_list.h"
+#include "snapshot.h"
+#include "term_dictionary.h"
+
+// Compressed posting lists sorted by document id, addressed by interned term id.
+// New postings collect in an uncompressed write buffer, which is sealed into a segment of
+// compressed lists once it fills up. Segments are merged in size tiers, so a posting is rewritten
+// O(log n) times however the ids arrive. All postings of a document lie in one segment, and queries
+// are evaluated segment by segment. Postings of removed documents stay in the lists until they
+// are purged in a batch. Words leave the dictionary once their last posting is purged.
+class InvertedIndex {
+public:
+    // Postings in the write buffer that make it be sealed
+    inline static constexpr size_t BUFFER_POSTING_COUNT = 1 << 18;
+
+    // Postings of a term in one sealed segment
+    struct Run {
+        uint32_t segment_id;
+        PostingList postings;
+        // Postings of a loaded snapshot are read from the file until the run is changed
+        PostingView mapped_postings;
+
+        PostingView GetPostings() const;
+    };
+
+    struct Term {
+        // Non-empty runs in the order of the segments
+        std::vector<Run> runs;
+        // Postings in the write buffer, sorted by document id
+        std::vector<Posting> buffered_postings;
+        size_t posting_count = 0;
+        // Removed documents whose postings are still in the lists
+        size_t removed_document_count = 0;
+        // log(document count), kept up to date so that queries don't call log()
+        double log_document_freq = 0.0;
+        // Upper bound of the term frequency over the postings. It is not lowered when
+        // documents are removed, which keeps it a valid if looser bound
+        double max_term_freq = 0.0;
+
+        // Documents with the term that are not removed
+        size_t GetDocumentCount() const;
+
+        // Calls function(const Posting&) for all postings, segment by segment
+        template <typename Function>
+        void ForEachPosting(Function function) const;
+    };
+
+    // Interns the word, the term stays empty until a posting is added
+    TermId AddWord(std::string_view word);
+
+    // The document must not have a posting for the term yet
+    void AddPosting(TermId term_id, int document_id, uint32_t document_ordinal, uint32_t count, double term_freq);
+
+    // Is called between documents, so that the postings of a document stay in one segment
+    void SealBufferIfFull();
+
+    std::optional<TermId> FindTermId(std::string_view word) const;
+
+    std::string_view GetWord(TermId term_id) const;
+
+    const Term& GetTerm(TermId term_id) const;
+
+    // Upper bound of the term ids, free ids included
+    size_t GetTermIdCount() const;
+
+    // Sealed segments and the write buffer, which goes last
+    size_t GetSegmentCount() const;
+
+    // Postings of the term in the segment with the given index
+    PostingView GetSegmentPostings(const Term& term, size_t segment) const;
+
+    // Adds postings of documents that are not indexed yet. The lists given for a term
+    // are sorted by document id and follow each other in increasing id order.
+    // term_freq(const Posting&) gives the term frequency of a posting
+    template <typename ExecutionPolicy, typename TermFreq>
+    void MergePostings(ExecutionPolicy policy, std::vector<std::pair<TermId, std::vector<std::vector<Posting>>>>& term_postings, TermFreq term_freq);
+
+    // Is called for every term of a removed document. Only the document frequency changes,
+    // the postings stay until PurgePostings
+    void MarkDocumentRemoved(TermId term_id);
+
+    // Drops the postings for which is_removed(const Posting&) is true from the given terms,
+    // which must include every term of the documents marked as removed
+    template <typename ExecutionPolicy, typename IsRemoved>
+    void PurgePostings(ExecutionPolicy policy, const std::vector<TermId>& term_ids, IsRemoved is_removed);
+
+    // Moves words out of mostly released storage, see TermDictionary::CompactWords
+    void CompactWords();
+
+    // Writes the words and posting lists of all term ids as one segment. Only postings of
+    // live_ordinals are written, terms left without postings are written as free ids. The packed
+    // postings of all terms share 32-bit offsets, std::length_error is thrown past 4 GiB of them
+    void SaveSnapshot(SnapshotWriter& writer, const OrdinalBitmap& live_ordinals) const;
+
+    // Replaces the contents with a snapshot. Words and posting lists are used right
+    // from the file, which is kept mapped while the index lives
+    void LoadSnapshot(SnapshotReader& reader, std::shared_ptr<const MappedFile> file);
+
+    // Throws if a posting of the loaded snapshot has an ordinal not below ordinal_count.
+    // Ordinals come after the index in the file, so they are checked separately
+    void CheckSnapshotOrdinals(size_t ordinal_count) const;
+
+private:
+    struct Segment {
+        // Ids grow from older segments to newer ones
+        uint32_t id;
+        size_t posting_count;
+        // Sorted, may keep terms whose postings in the segment have been purged
+        std::vector<TermId> term_ids;
+    };
+
+    TermDictionary dictionary_;
+    std::vector<Term> terms_;
+    std::vector<Segment> segments_;
+    uint32_t next_segment_id_ = 0;
+    std::vector<TermId> buffer_term_ids_;
+    size_t buffer_posting_count_ = 0;
+    std::shared_ptr<const MappedFile> snapshot_file_;
+
+    // Copies mapped postings into the run before they are changed
+    static PostingList& GetOwnedPostings(Run& run);
+
+    // Starts a new segment with the buffered postings, then merges the newest segment into the
+    // previous one while that is at most twice as large, so that sizes at least double towards older ones
+    void SealBuffer();
+
+    void MergeLastSegments();
+
+    // Merges the postings of the newer run into the older one
+    static void MergeRuns(Run& older, const Run& newer);
+
+    size_t FindSegment(uint32_t segment_id) const;
+
+    // Postings of the given terms in every segment, the write buffer goes last
+    std::vector<size_t> CountSegmentPostings(const std::vector<TermId>& term_ids) const;
+
+    void ReleaseTerm(TermId term_id);
+};
+
+template <typename Function>
+void InvertedIndex::Term::ForEachPosting(Function function) const {
+    for (const Run& run : runs) {
+        run.GetPostings().ForEach(function);
+    }
+    std::for_each(buffered_postings.begin(), buffered_postings.end(), function);
+}
+
+template <typename ExecutionPolicy, typename TermFreq>
+void InvertedIndex::MergePostings(ExecutionPolicy policy, std::vector<std::pair<TermId, std::vector<std::vector<Posting>>>>& term_postings, TermFreq term_freq) {
+    for (const auto& [term_id, lists] : term_postings) {
+        if (terms_[term_id].buffered_postings.empty()) {
+            buffer_term_ids_.push_back(term_id);
+        }
+        for (const std::vector<Posting>& list : lists) {
+            buffer_posting_count_ += list.size();
+        }
+    }
+    std::for_each(policy, term_postings.begin(), term_postings.end(), [this, &term_freq](const auto& term_lists) {
+        Term& term = terms_[term_lists.first];
+        std::vector<Posting>& buffered = term.buffered_postings;
+        const size_t buffered_size = buffered.size();
+        for (const std::vector<Posting>& list : term_lists.second) {
+            for (const Posting& posting : list) {
+                buffered.push_back(posting);
+                term.max_term_freq = std::max(term.max_term_freq, term_freq(posting));
+            }
+        }
+        // A batch of ids above the buffered ones, the usual bulk load, is already in order
+        if (buffered_size > 0 && buffered_size < buffered.size() && buffered[buffered_size].document_id < buffered[buffered_size - 1].document_id) {
+            std::inplace_merge(buffered.begin(), buffered.begin() + buffered_size, buffered.end(), [](const Posting& lhs, const Posting& rhs) {
+                return lhs.document_id < rhs.document_id;
+                });
+        }
+        term.posting_count += buffered.size() - buffered_size;
+        term.log_document_freq = std::log(static_cast<double>(term.GetDocumentCount()));
+        });
+    SealBufferIfFull();
+}
+
+template <typename ExecutionPolicy, typename IsRemoved>
+void InvertedIndex::PurgePostings(ExecutionPolicy policy, const std::vector<TermId>& term_ids, IsRemoved is_removed) {
+    const std::vector<size_t> segment_posting_counts = CountSegmentPostings(term_ids);
+    // Posting lists of different terms are independent, the segments and the dictionary
+    // are only changed afterwards
+    std::for_each(policy, term_ids.begin(), term_ids.end(), [&](TermId term_id) {
+        Term& term = terms_[term_id];
+        term.posting_count = 0;
+        for (Run& run : term.runs) {
+            GetOwnedPostings(run).EraseIf(is_removed);
+            term.posting_count += run.postings.size();
+        }
+        term.runs.erase(std::remove_if(term.runs.begin(), term.runs.end(), [](const Run& run) {
+            return run.postings.empty();
+            }), term.runs.end());
+        std::vector<Posting>& buffered = term.buffered_postings;
+        buffered.erase(std::remove_if(buffered.begin(), buffered.end(), is_removed), buffered.end());
+        term.posting_count += buffered.size();
+        term.removed_document_count = 0;
+        });
+    const std::vector<size_t> purged_posting_counts = CountSegmentPostings(term_ids);
+    for (size_t segment = 0; segment < segments_.size(); ++segment) {
+        segments_[segment].posting_count -= segment_posting_counts[segment] - purged_posting_counts[segment];
+    }
+    buffer_posting_count_ -= segment_posting_counts.back() - purged_posting_counts.back();
+    segments_.erase(std::remove_if(segments_.begin(), segments_.end(), [](const Segment& segment) {
+        return segment.posting_count == 0;
+        }), segments_.end());
+    for (const TermId term_id : term_ids) {
+        if (terms_[term_id].posting_count == 0) {
+            ReleaseTerm(term_id);
+        }
+    }
+}
\ No newline at end of file
@@ -11,10 +11,16 @@
 #include <numeric>
 #include <stdexcept>
 #include <deque>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <mutex>
+#include <thread>
 
 #include "paginator.h"
 #include "document.h"
 #include "request_queue.h"
+#include "concurrent_search_server.h"
 #include "search_server.h"
 #include "string_processing.h"
 #include "read_input_functions.h"
@@ -33,12 +39,12 @@ void PrintDocument(const Document& document) {
         << "rating = "s << document.rating << " }"s << std::endl;
 }
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status) {
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status) {
     std::cout << "{ "s
         << "document_id = "s << document_id << ", "s
         << "status = "s << static_cast<int>(status) << ", "s
         << "words ="s;
-    for (const std::string& word : words) {
+    for (const std::string_view word : words) {
         std::cout << ' ' << word;
     }
     std::cout << "}"s << std::endl;
@@ -69,9 +75,11 @@ void FindTopDocuments(const SearchServer& search_server, const std::string& raw_
 void MatchDocuments(const SearchServer& search_server, const std::string& query) {
     try {
         std::cout << "Матчинг документов по запросу: "s << query << std::endl;
-        for (const int document_id : search_server) {
-            const auto [words, status] = search_server.MatchDocument(query, document_id);
-            PrintMatchDocumentResult(document_id, words, status);
+        const std::vector<int> document_ids(search_server.begin(), search_server.end());
+        const auto results = search_server.MatchDocuments(query, document_ids);
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto& [words, status] = results[i];
+            PrintMatchDocumentResult(document_ids[i], words, status);
         }
     }
     catch (const std::exception& e) {
@@ -79,7 +87,85 @@ void MatchDocuments(const SearchServer& search_server, const std::string& query)
     }
 }
 
-int main() {
+// Сколько запросов и изменений успевают выполнить за секунду читатели и писатель, работающие одновременно.
+// find(query) и write(id, text) работают с проверяемым сервером, перед замером в нём уже есть документы
+template <typename Find, typename Write>
+void BenchmarkMixedReadWrite(const std::string& name, Find find, Write write) {
+    const int reader_count = 3;
+    const int initial_document_count = 5000;
+    const auto duration = std::chrono::seconds(1);
+    std::mt19937 generator(5);
+    const auto make_text = [&generator](int word_count) {
+        std::string text;
+        for (int i = 0; i < word_count; ++i) {
+            text += "w"s + std::to_string(generator() % 1000) + " "s;
+        }
+        return text;
+    };
+    std::vector<std::string> queries(100);
+    for (std::string& query : queries) {
+        query = make_text(3);
+    }
+    int id = 0;
+    for (; id < initial_document_count; ++id) {
+        write(id, make_text(10));
+    }
+    std::atomic<bool> running{ true };
+    std::atomic<int64_t> query_count{ 0 };
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < reader_count; ++reader) {
+        readers.emplace_back([&, reader] {
+            for (size_t i = reader; running.load(); ++i) {
+                find(queries[i % queries.size()]);
+                ++query_count;
+            }
+            });
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (; std::chrono::steady_clock::now() - start < duration; ++id) {
+        write(id, make_text(10));
+    }
+    running = false;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << name << ": "s << (id - initial_document_count) / seconds << " writes/s, "s
+        << query_count.load() / seconds << " queries/s"s << std::endl;
+}
+
+void BenchmarkConcurrentSearch() {
+    {
+        // Обычный сервер: на время записи запросы останавливаются. С std::shared_mutex
+        // писатель может не дождаться, пока читатели отпустят блокировку, поэтому мьютекс простой
+        SearchServer search_server("and with"s);
+        std::mutex mutex;
+        BenchmarkMixedReadWrite("std::mutex"s, [&](const std::string& query) {
+            std::lock_guard lock(mutex);
+            return search_server.FindTopDocuments(query);
+            }, [&](int id, const std::string& text) {
+                std::lock_guard lock(mutex);
+                search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 1 });
+                if (id % 4 == 3) {
+                    search_server.RemoveDocument(id - 3);
+                }
+            });
+    }
+    {
+        ConcurrentSearchServer search_server("and with"s);
+        BenchmarkMixedReadWrite("ConcurrentSearchServer"s, [&](const std::string& query) {
+            return search_server.FindTopDocuments(query);
+            }, [&](int id, const std::string& text) {
+                search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 1 });
+                if (id % 4 == 3) {
+                    search_server.RemoveDocument(id - 3);
+                }
+            });
+    }
+}
+
+// С ключом --bench после демонстрации замеряется ConcurrentSearchServer, замер идёт около двух секунд
+int main(int argc, char* argv[]) {
     TestSearchServer();
     SearchServer search_server("and with"s);
 
@@ -110,4 +196,8 @@ int main() {
     std::cout << "Before duplicates removed: "s << search_server.GetDocumentCount() << std::endl;
     RemoveDuplicates(search_server);
     std::cout << "After duplicates removed: "s << search_server.GetDocumentCount() << std::endl;
+
+    if (argc > 1 && argv[1] == "--bench"s) {
+        BenchmarkConcurrentSearch();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "max_score_evaluator.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+MaxScoreEvaluator::MaxScoreEvaluator(const std::vector<PlusTerm>& plus_terms, const std::vector<PostingView>& minus_postings,
+    const std::vector<double>& inverse_word_counts, const OrdinalBitmap* allowed_ordinals, int first_id, int64_t last_id)
+{
+    Start(plus_terms, minus_postings, inverse_word_counts, allowed_ordinals, first_id, last_id);
+}
+
+void MaxScoreEvaluator::Start(const std::vector<PlusTerm>& plus_terms, const std::vector<PostingView>& minus_postings,
+    const std::vector<double>& inverse_word_counts, const OrdinalBitmap* allowed_ordinals, int first_id, int64_t last_id) {
+    terms_.assign(plus_terms.begin(), plus_terms.end());
+    inverse_word_counts_ = &inverse_word_counts;
+    allowed_ordinals_ = allowed_ordinals;
+    last_id_ = last_id;
+    order_.resize(terms_.size());
+    prefix_bounds_.assign(terms_.size() + 1, 0.0);
+    relevances_.assign(terms_.size(), 0.0);
+    essential_begin_ = 0;
+    cursors_.clear();
+    for (const PlusTerm& term : terms_) {
+        cursors_.emplace_back(term.postings);
+        cursors_.back().Seek(first_id);
+    }
+    // The bitmap keeps its size, so it is only cleared after an evaluation that set bits in it
+    if (has_excluded_ordinals_) {
+        excluded_ordinals_.Clear();
+    }
+    has_excluded_ordinals_ = !minus_postings.empty();
+    for (const PostingView& postings : minus_postings) {
+        postings.ForEach([this](const Posting& posting) {
+            excluded_ordinals_.Set(posting.document_ordinal);
+            }, first_id, last_id);
+    }
+    std::iota(order_.begin(), order_.end(), 0);
+    std::sort(order_.begin(), order_.end(), [this](size_t lhs, size_t rhs) {
+        return terms_[lhs].max_relevance < terms_[rhs].max_relevance;
+        });
+    for (size_t i = 0; i < order_.size(); ++i) {
+        prefix_bounds_[i + 1] = prefix_bounds_[i] + terms_[order_[i]].max_relevance;
+    }
+}
+
+bool MaxScoreEvaluator::Next(double min_relevance, Match& match) {
+    // The needed relevance only grows, so terms move from essential to non-essential
+    while (essential_begin_ < order_.size() && prefix_bounds_[essential_begin_ + 1] < min_relevance) {
+        ++essential_begin_;
+    }
+    while (true) {
+        int64_t document_id = last_id_;
+        for (size_t i = essential_begin_; i < order_.size(); ++i) {
+            if (IsCursorInRange(order_[i])) {
+                document_id = std::min<int64_t>(document_id, cursors_[order_[i]].GetPosting().document_id);
+            }
+        }
+        if (document_id == last_id_) {
+            return false;
+        }
+
+        // Excluded documents are dropped with a bit test before anything is scored
+        uint32_t ordinal = 0;
+        double bound = 0.0;
+        bool found = false;
+        bool excluded = false;
+        std::fill(relevances_.begin(), relevances_.end(), 0.0);
+        for (size_t i = essential_begin_; i < order_.size(); ++i) {
+            const size_t term = order_[i];
+            if (IsCursorInRange(term) && cursors_[term].GetPosting().document_id == document_id) {
+                const Posting& posting = cursors_[term].GetPosting();
+                if (!found) {
+                    found = true;
+                    ordinal = posting.document_ordinal;
+                    excluded = IsExcluded(ordinal);
+                }
+                if (!excluded) {
+                    relevances_[term] = ComputeRelevance(term, posting);
+                    bound += relevances_[term];
+                }
+                cursors_[term].Next();
+            }
+        }
+        if (excluded) {
+            continue;
+        }
+        // Non-essential terms are looked up from the largest bound while the document can still qualify
+        bool qualifies = true;
+        for (size_t i = essential_begin_; i > 0; --i) {
+            if (bound + prefix_bounds_[i] < min_relevance) {
+                qualifies = false;
+                break;
+            }
+            const size_t term = order_[i - 1];
+            PostingCursor& cursor = cursors_[term];
+            cursor.Seek(static_cast<int>(document_id));
+            if (!cursor.AtEnd() && cursor.GetPosting().document_id == document_id) {
+                relevances_[term] = ComputeRelevance(term, cursor.GetPosting());
+                bound += relevances_[term];
+            }
+        }
+        if (!qualifies || bound < min_relevance) {
+            continue;
+        }
+        match.document_id = static_cast<int>(document_id);
+        match.document_ordinal = ordinal;
+        match.relevance = 0.0;
+        for (const double relevance : relevances_) {
+            match.relevance += relevance;
+        }
+        return true;
+    }
+}
+
+bool MaxScoreEvaluator::IsCursorInRange(size_t term) const {
+    return !cursors_[term].AtEnd() && cursors_[term].GetPosting().document_id < last_id_;
+}
+
+double MaxScoreEvaluator::ComputeRelevance(size_t term, const Posting& posting) const {
+    return posting.count * (*inverse_word_counts_)[posting.document_ordinal] * terms_[term].inverse_document_freq;
+}
+
+bool MaxScoreEvaluator::IsExcluded(uint32_t ordinal) const {
+    return excluded_ordinals_.Test(ordinal) || (allowed_ordinals_ != nullptr && !allowed_ordinals_->Test(ordinal));
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ordinal_bitmap.h"
+#include "posting_list.h"
+
+// Document-at-a-time evaluation of a query with MaxScore pruning. Plus terms are ordered by
+// their relevance bound; the terms whose bounds together stay below the relevance a document
+// needs are only looked up for documents found through the other terms. Documents with minus words
+// or outside the allowed set are dropped by a bit test before they are scored
+class MaxScoreEvaluator {
+public:
+    struct PlusTerm {
+        PostingView postings;
+        double inverse_document_freq;
+        // max term frequency * IDF, no posting of the term adds more to a relevance
+        double max_relevance;
+    };
+
+    struct Match {
+        int document_id;
+        uint32_t document_ordinal;
+        double relevance;
+    };
+
+    MaxScoreEvaluator() = default;
+
+    // Evaluates documents with first_id <= id < last_id. Term frequencies are posting counts
+    // multiplied by inverse_word_counts[ordinal]. If allowed_ordinals is given, other documents are skipped
+    MaxScoreEvaluator(const std::vector<PlusTerm>& plus_terms, const std::vector<PostingView>& minus_postings,
+        const std::vector<double>& inverse_word_counts, const OrdinalBitmap* allowed_ordinals, int first_id, int64_t last_id);
+
+    // Starts a new evaluation with the arguments of the constructor. The memory
+    // of the previous one is reused, so a warmed up evaluator doesn't allocate
+    void Start(const std::vector<PlusTerm>& plus_terms, const std::vector<PostingView>& minus_postings,
+        const std::vector<double>& inverse_word_counts, const OrdinalBitmap* allowed_ordinals, int first_id, int64_t last_id);
+
+    // Finds the next document in id order without minus words whose relevance is at least min_relevance.
+    // The relevance is summed in the order of plus_terms, as term-at-a-time scoring does
+    bool Next(double min_relevance, Match& match);
+
+private:
+    std::vector<PlusTerm> terms_;
+    std::vector<PostingCursor> cursors_;
+    const std::vector<double>* inverse_word_counts_ = nullptr;
+    const OrdinalBitmap* allowed_ordinals_ = nullptr;
+    // Documents of the range with minus words, collected once before the evaluation
+    OrdinalBitmap excluded_ordinals_;
+    bool has_excluded_ordinals_ = false;
+    int64_t last_id_ = 0;
+    // Term indexes by increasing bound and sums of the bounds of the first k of them
+    std::vector<size_t> order_;
+    std::vector<double> prefix_bounds_;
+    // Terms order_[0, essential_begin_) are non-essential
+    size_t essential_begin_ = 0;
+    std::vector<double> relevances_;
+
+    bool IsCursorInRange(size_t term) const;
+
+    double ComputeRelevance(size_t term, const Posting& posting) const;
+
+    bool IsExcluded(uint32_t ordinal) const;
+};
\ No newline at end of file
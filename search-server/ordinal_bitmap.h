@@ -0,0 +1,37 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Set of document ordinals, one bit per ordinal. Ordinals are dense, so a plain
+// bit array stays small and a membership check is one load and one bit test
+class OrdinalBitmap {
+public:
+    void Set(uint32_t ordinal) {
+        const size_t word = ordinal / 64;
+        if (words_.size() <= word) {
+            words_.resize(word + 1, 0);
+        }
+        words_[word] |= uint64_t{ 1 } << (ordinal % 64);
+    }
+
+    void Reset(uint32_t ordinal) {
+        const size_t word = ordinal / 64;
+        if (word < words_.size()) {
+            words_[word] &= ~(uint64_t{ 1 } << (ordinal % 64));
+        }
+    }
+
+    bool Test(uint32_t ordinal) const {
+        const size_t word = ordinal / 64;
+        return word < words_.size() && (words_[word] >> (ordinal % 64) & 1) != 0;
+    }
+
+    // Keeps the memory for the next use
+    void Clear() {
+        std::fill(words_.begin(), words_.end(), 0);
+    }
+
+private:
+    std::vector<uint64_t> words_;
+};
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "posting_list.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+unsigned GetBitWidth(uint32_t value) {
+    unsigned bits = 0;
+    for (; value != 0; value >>= 1) {
+        ++bits;
+    }
+    return bits;
+}
+
+size_t GetPackedSize(size_t count, unsigned bits) {
+    return (count * bits + 7) / 8;
+}
+
+// Data offsets of blocks are 32-bit, so data that can't be addressed is rejected before it is written
+void CheckDataOffset(size_t offset) {
+    if (offset > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("      4 ");
+    }
+}
+
+// Both helpers touch 8 bytes starting at the value's first byte, which the padding allows
+void Pack(uint8_t* data, size_t index, unsigned bits, uint32_t value) {
+    const size_t bit = index * bits;
+    uint64_t word;
+    std::memcpy(&word, data + bit / 8, sizeof(word));
+    word |= static_cast<uint64_t>(value) << (bit % 8);
+    std::memcpy(data + bit / 8, &word, sizeof(word));
+}
+
+uint32_t Unpack(const uint8_t* data, size_t index, unsigned bits) {
+    const size_t bit = index * bits;
+    uint64_t word;
+    std::memcpy(&word, data + bit / 8, sizeof(word));
+    return static_cast<uint32_t>((word >> (bit % 8)) & ((uint64_t{ 1 } << bits) - 1));
+}
+
+} // namespace
+
+void EncodePostingBlocks(const Posting* first, const Posting* last, std::vector<PostingBlock>& blocks, std::vector<uint8_t>& data) {
+    const size_t count = last - first;
+    // Sizes are evened out, so that a block split by an insertion doesn't leave a tiny one
+    const size_t block_count = (count + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+    for (size_t i = 0; i < block_count; ++i) {
+        const Posting* const block_first = first + count * i / block_count;
+        const Posting* const block_last = first + count * (i + 1) / block_count;
+        const size_t size = block_last - block_first;
+        uint32_t max_id_gap = 0;
+        uint32_t max_ordinal = 0;
+        uint32_t max_count = 0;
+        for (const Posting* posting = block_first; posting != block_last; ++posting) {
+            if (posting != block_first) {
+                max_id_gap = std::max(max_id_gap, static_cast<uint32_t>(posting->document_id - (posting - 1)->document_id));
+            }
+            max_ordinal = std::max(max_ordinal, posting->document_ordinal);
+            max_count = std::max(max_count, posting->count);
+        }
+        CheckDataOffset(data.size());
+        PostingBlock block{
+            block_first->document_id,
+            (block_last - 1)->document_id,
+            static_cast<uint32_t>(data.size()),
+            static_cast<uint16_t>(size),
+            static_cast<uint8_t>(GetBitWidth(max_id_gap)),
+            static_cast<uint8_t>(GetBitWidth(max_ordinal)),
+            static_cast<uint8_t>(GetBitWidth(max_count))
+        };
+        const size_t id_gaps_size = GetPackedSize(size, block.id_gap_bits);
+        const size_t ordinals_size = GetPackedSize(size, block.ordinal_bits);
+        const size_t counts_size = GetPackedSize(size, block.count_bits);
+        data.resize(block.data_offset + id_gaps_size + ordinals_size + counts_size + POSTING_DATA_PADDING, 0);
+        uint8_t* const id_gaps = data.data() + block.data_offset;
+        uint8_t* const ordinals = id_gaps + id_gaps_size;
+        uint8_t* const counts = ordinals + ordinals_size;
+        for (size_t index = 0; index < size; ++index) {
+            const Posting& posting = block_first[index];
+            if (index > 0) {
+                Pack(id_gaps, index, block.id_gap_bits, posting.document_id - block_first[index - 1].document_id);
+            }
+            Pack(ordinals, index, block.ordinal_bits, posting.document_ordinal);
+            Pack(counts, index, block.count_bits, posting.count);
+        }
+        data.resize(data.size() - POSTING_DATA_PADDING);
+        blocks.push_back(block);
+    }
+}
+
+bool IsValidPostingBlock(const PostingBlock& block, size_t data_size) {
+    if (block.size == 0 || block.size > POSTING_BLOCK_SIZE || block.id_gap_bits > 32 || block.ordinal_bits > 32 || block.count_bits > 32) {
+        return false;
+    }
+    return block.data_offset <= data_size && GetPackedBlockSize(block) <= data_size - block.data_offset;
+}
+
+bool AreBlockOrdinalsBelow(const PostingBlock& block, const uint8_t* data, size_t ordinal_count) {
+    // A width too narrow for an ordinal out of range needs no unpacking
+    if (block.ordinal_bits < 32 && (uint64_t{ 1 } << block.ordinal_bits) <= ordinal_count) {
+        return true;
+    }
+    const uint8_t* const ordinals = data + block.data_offset + GetPackedSize(block.size, block.id_gap_bits);
+    for (size_t index = 0; index < block.size; ++index) {
+        if (Unpack(ordinals, index, block.ordinal_bits) >= ordinal_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t GetPackedBlockSize(const PostingBlock& block) {
+    return GetPackedSize(block.size, block.id_gap_bits) + GetPackedSize(block.size, block.ordinal_bits)
+        + GetPackedSize(block.size, block.count_bits);
+}
+
+void DecodePostingBlock(const PostingBlock& block, const uint8_t* data, Posting* output) {
+    const uint8_t* const id_gaps = data + block.data_offset;
+    const uint8_t* const ordinals = id_gaps + GetPackedSize(block.size, block.id_gap_bits);
+    const uint8_t* const counts = ordinals + GetPackedSize(block.size, block.ordinal_bits);
+    // The three fields are unpacked in separate passes, each with a fixed width and no branches
+    for (size_t index = 0; index < block.size; ++index) {
+        output[index].document_ordinal = Unpack(ordinals, index, block.ordinal_bits);
+    }
+    for (size_t index = 0; index < block.size; ++index) {
+        output[index].count = Unpack(counts, index, block.count_bits);
+    }
+    int document_id = block.first_document_id;
+    for (size_t index = 0; index < block.size; ++index) {
+        document_id += static_cast<int>(Unpack(id_gaps, index, block.id_gap_bits));
+        output[index].document_id = document_id;
+    }
+}
+
+PostingView::PostingView(const PostingBlock* blocks, size_t block_count, const uint8_t* data, const Posting* tail, size_t tail_size, size_t size)
+    : blocks_(blocks)
+    , block_count_(block_count)
+    , data_(data)
+    , tail_(tail)
+    , tail_size_(tail_size)
+    , size_(size)
+{
+}
+
+size_t PostingView::size() const {
+    return size_;
+}
+
+bool PostingView::empty() const {
+    return size_ == 0;
+}
+
+int PostingView::GetApproximateDocumentId(size_t position) const {
+    for (const PostingBlock* block = blocks_; block != blocks_ + block_count_; ++block) {
+        if (position < block->size) {
+            return block->first_document_id;
+        }
+        position -= block->size;
+    }
+    if (tail_size_ == 0) {
+        return blocks_[block_count_ - 1].last_document_id;
+    }
+    return tail_[std::min(position, tail_size_ - 1)].document_id;
+}
+
+int PostingView::GetFirstDocumentId() const {
+    return block_count_ > 0 ? blocks_[0].first_document_id : tail_[0].document_id;
+}
+
+int PostingView::GetLastDocumentId() const {
+    return tail_size_ > 0 ? tail_[tail_size_ - 1].document_id : blocks_[block_count_ - 1].last_document_id;
+}
+
+std::vector<Posting> PostingView::Decode() const {
+    std::vector<Posting> postings;
+    postings.reserve(size_);
+    ForEach([&postings](const Posting& posting) {
+        postings.push_back(posting);
+        });
+    return postings;
+}
+
+const PostingBlock* PostingView::GetBlocks() const {
+    return blocks_;
+}
+
+size_t PostingView::GetBlockCount() const {
+    return block_count_;
+}
+
+const uint8_t* PostingView::GetData() const {
+    return data_;
+}
+
+const Posting* PostingView::GetTail() const {
+    return tail_;
+}
+
+size_t PostingView::GetTailSize() const {
+    return tail_size_;
+}
+
+PostingCursor::PostingCursor(const PostingView& view)
+    : view_(view)
+{
+    LoadNext();
+}
+
+PostingCursor::PostingCursor(const PostingCursor& other)
+    : view_(other.view_)
+    , next_block_(other.next_block_)
+    , in_tail_(other.in_tail_)
+    , current_(other.current_)
+    , end_(other.end_)
+{
+    if (!in_tail_) {
+        std::copy(other.current_, other.end_, decoded_ + (other.current_ - other.decoded_));
+        current_ = decoded_ + (other.current_ - other.decoded_);
+        end_ = decoded_ + (other.end_ - other.decoded_);
+    }
+}
+
+void PostingCursor::Seek(int document_id) {
+    while (current_ != end_ && (end_ - 1)->document_id < document_id) {
+        if (!in_tail_) {
+            const PostingBlock* const blocks = view_.GetBlocks();
+            next_block_ = std::partition_point(blocks + next_block_, blocks + view_.GetBlockCount(), [document_id](const PostingBlock& block) {
+                return block.last_document_id < document_id;
+                }) - blocks;
+        }
+        LoadNext();
+    }
+    current_ = std::lower_bound(current_, end_, document_id, [](const Posting& posting, int id) {
+        return posting.document_id < id;
+        });
+}
+
+void PostingCursor::LoadNext() {
+    if (next_block_ < view_.GetBlockCount()) {
+        const PostingBlock& block = view_.GetBlocks()[next_block_++];
+        DecodePostingBlock(block, view_.GetData(), decoded_);
+        current_ = decoded_;
+        end_ = decoded_ + block.size;
+    }
+    else if (!in_tail_) {
+        in_tail_ = true;
+        current_ = view_.GetTail();
+        end_ = current_ + view_.GetTailSize();
+    }
+    else {
+        current_ = end_;
+    }
+}
+
+PostingList::PostingList(std::vector<Posting> postings)
+    : size_(postings.size())
+{
+    const size_t packed_size = postings.size() - postings.size() % POSTING_BLOCK_SIZE;
+    if (packed_size == 0) {
+        tail_ = std::move(postings);
+        return;
+    }
+    EncodePostingBlocks(postings.data(), postings.data() + packed_size, blocks_, data_);
+    data_.resize(data_.size() + POSTING_DATA_PADDING, 0);
+    tail_.assign(postings.begin() + packed_size, postings.end());
+}
+
+PostingView PostingList::GetView() const {
+    return { blocks_.data(), blocks_.size(), data_.data(), tail_.data(), tail_.size(), size_ };
+}
+
+size_t PostingList::size() const {
+    return size_;
+}
+
+bool PostingList::empty() const {
+    return size_ == 0;
+}
+
+void PostingList::Add(const Posting& posting) {
+    ++size_;
+    if (blocks_.empty() || blocks_.back().last_document_id < posting.document_id) {
+        // Documents mostly arrive with growing ids, so the common case is an append to the tail
+        if (tail_.empty() || tail_.back().document_id < posting.document_id) {
+            tail_.push_back(posting);
+        }
+        else {
+            tail_.insert(std::upper_bound(tail_.begin(), tail_.end(), posting.document_id, [](int id, const Posting& other) {
+                return id < other.document_id;
+                }), posting);
+        }
+        if (tail_.size() == POSTING_BLOCK_SIZE) {
+            ReplaceBlocks(blocks_.size(), blocks_.size(), tail_);
+            tail_.clear();
+        }
+        return;
+    }
+    const size_t block_index = FindBlock(posting.document_id);
+    std::vector<Posting> postings(blocks_[block_index].size + 1);
+    DecodePostingBlock(blocks_[block_index], data_.data(), postings.data());
+    postings.back() = posting;
+    std::inplace_merge(postings.begin(), postings.end() - 1, postings.end(), [](const Posting& lhs, const Posting& rhs) {
+        return lhs.document_id < rhs.document_id;
+        });
+    ReplaceBlocks(block_index, block_index + 1, postings);
+}
+
+bool PostingList::Erase(int document_id) {
+    const auto by_id = [](const Posting& posting, int id) {
+        return posting.document_id < id;
+    };
+    if (blocks_.empty() || blocks_.back().last_document_id < document_id) {
+        const auto it = std::lower_bound(tail_.begin(), tail_.end(), document_id, by_id);
+        if (it == tail_.end() || it->document_id != document_id) {
+            return false;
+        }
+        tail_.erase(it);
+        --size_;
+        return true;
+    }
+    const size_t block_index = FindBlock(document_id);
+    if (blocks_[block_index].first_document_id > document_id) {
+        return false;
+    }
+    std::vector<Posting> postings(blocks_[block_index].size);
+    DecodePostingBlock(blocks_[block_index], data_.data(), postings.data());
+    const auto it = std::lower_bound(postings.begin(), postings.end(), document_id, by_id);
+    if (it == postings.end() || it->document_id != document_id) {
+        return false;
+    }
+    postings.erase(it);
+    ReplaceBlocks(block_index, block_index + 1, postings);
+    --size_;
+    return true;
+}
+
+void PostingList::Append(const PostingView& postings) {
+    const PostingBlock* block = postings.GetBlocks();
+    const PostingBlock* const blocks_end = block + postings.GetBlockCount();
+    if (!tail_.empty() && block != blocks_end) {
+        const size_t tail_size = tail_.size();
+        tail_.resize(tail_size + block->size);
+        DecodePostingBlock(*block, postings.GetData(), tail_.data() + tail_size);
+        ReplaceBlocks(blocks_.size(), blocks_.size(), tail_);
+        tail_.clear();
+        ++block;
+    }
+    if (block != blocks_end) {
+        // Blocks of a view lie one after another in its data
+        const size_t source_begin = block->data_offset;
+        const size_t source_end = (blocks_end - 1)->data_offset + GetPackedBlockSize(*(blocks_end - 1));
+        const size_t data_end = data_.empty() ? 0 : data_.size() - POSTING_DATA_PADDING;
+        CheckDataOffset(data_end + (source_end - source_begin));
+        data_.resize(data_end);
+        data_.insert(data_.end(), postings.GetData() + source_begin, postings.GetData() + source_end);
+        data_.resize(data_.size() + POSTING_DATA_PADDING, 0);
+        for (; block != blocks_end; ++block) {
+            blocks_.push_back(*block);
+            blocks_.back().data_offset = static_cast<uint32_t>(block->data_offset - source_begin + data_end);
+        }
+    }
+    tail_.insert(tail_.end(), postings.GetTail(), postings.GetTail() + postings.GetTailSize());
+    size_ += postings.size();
+    if (tail_.size() >= POSTING_BLOCK_SIZE) {
+        const size_t packed_size = tail_.size() - tail_.size() % POSTING_BLOCK_SIZE;
+        ReplaceBlocks(blocks_.size(), blocks_.size(), std::vector<Posting>(tail_.begin(), tail_.begin() + packed_size));
+        tail_.erase(tail_.begin(), tail_.begin() + packed_size);
+    }
+}
+
+void PostingList::ReplaceBlocks(size_t first, size_t last, const std::vector<Posting>& postings) {
+    std::vector<PostingBlock> new_blocks;
+    std::vector<uint8_t> new_data;
+    EncodePostingBlocks(postings.data(), postings.data() + postings.size(), new_blocks, new_data);
+    if (data_.empty()) {
+        data_.resize(POSTING_DATA_PADDING, 0);
+    }
+    const size_t data_end = data_.size() - POSTING_DATA_PADDING;
+    const size_t begin_offset = first < blocks_.size() ? blocks_[first].data_offset : data_end;
+    const size_t end_offset = last < blocks_.size() ? blocks_[last].data_offset : data_end;
+    CheckDataOffset(data_end - (end_offset - begin_offset) + new_data.size());
+    for (PostingBlock& block : new_blocks) {
+        block.data_offset += static_cast<uint32_t>(begin_offset);
+    }
+    for (size_t i = last; i < blocks_.size(); ++i) {
+        blocks_[i].data_offset = static_cast<uint32_t>(blocks_[i].data_offset - end_offset + begin_offset + new_data.size());
+    }
+    data_.erase(data_.begin() + begin_offset, data_.begin() + end_offset);
+    data_.insert(data_.begin() + begin_offset, new_data.begin(), new_data.end());
+    blocks_.erase(blocks_.begin() + first, blocks_.begin() + last);
+    blocks_.insert(blocks_.begin() + first, new_blocks.begin(), new_blocks.end());
+    if (blocks_.empty()) {
+        data_.clear();
+    }
+}
+
+size_t PostingList::FindBlock(int document_id) const {
+    return std::partition_point(blocks_.begin(), blocks_.end(), [document_id](const PostingBlock& block) {
+        return block.last_document_id < document_id;
+        }) - blocks_.begin();
+}
\ No newline at end of file
@@ -0,0 +1,236 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+struct Posting {
+    int document_id;
+    uint32_t document_ordinal;
+    // Occurrences of the word in the document
+    uint32_t count;
+};
+
+// Postings of up to BLOCK_SIZE documents. The first id is stored as is, the gaps between ids,
+// the ordinals and the counts are bit-packed, each with the smallest width that fits the block
+struct PostingBlock {
+    int first_document_id;
+    int last_document_id;
+    uint32_t data_offset;
+    uint16_t size;
+    uint8_t id_gap_bits;
+    uint8_t ordinal_bits;
+    uint8_t count_bits;
+};
+
+inline constexpr size_t POSTING_BLOCK_SIZE = 128;
+
+// Bytes that may be read past the packed data, so that every value is unpacked with one 8 byte load
+inline constexpr size_t POSTING_DATA_PADDING = 8;
+
+// Read-only view of a posting list sorted by document id. The blocks may be owned
+// by a PostingList or lie in a mapped snapshot
+class PostingView {
+public:
+    PostingView() = default;
+
+    PostingView(const PostingBlock* blocks, size_t block_count, const uint8_t* data, const Posting* tail, size_t tail_size, size_t size);
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // Calls function(const Posting&) in id order for postings with first_id <= document_id < last_id
+    template <typename Function>
+    void ForEach(Function function, int first_id = 0, int64_t last_id = std::numeric_limits<int64_t>::max()) const;
+
+    // Document id of the posting at about the given position, used to cut lists into ranges
+    int GetApproximateDocumentId(size_t position) const;
+
+    int GetFirstDocumentId() const;
+
+    int GetLastDocumentId() const;
+
+    std::vector<Posting> Decode() const;
+
+    const PostingBlock* GetBlocks() const;
+
+    size_t GetBlockCount() const;
+
+    const uint8_t* GetData() const;
+
+    const Posting* GetTail() const;
+
+    size_t GetTailSize() const;
+
+private:
+    const PostingBlock* blocks_ = nullptr;
+    size_t block_count_ = 0;
+    const uint8_t* data_ = nullptr;
+    const Posting* tail_ = nullptr;
+    size_t tail_size_ = 0;
+    size_t size_ = 0;
+};
+
+// Walks a posting view in id order and can jump ahead, skipping whole blocks without decoding them
+class PostingCursor {
+public:
+    explicit PostingCursor(const PostingView& view);
+
+    // The copy points into its own decoded block
+    PostingCursor(const PostingCursor& other);
+    PostingCursor& operator=(const PostingCursor&) = delete;
+
+    bool AtEnd() const {
+        return current_ == end_;
+    }
+
+    const Posting& GetPosting() const {
+        return *current_;
+    }
+
+    void Next() {
+        if (++current_ == end_) {
+            LoadNext();
+        }
+    }
+
+    // Moves to the first posting with an id not less than the given one
+    void Seek(int document_id);
+
+private:
+    PostingView view_;
+    size_t next_block_ = 0;
+    bool in_tail_ = false;
+    const Posting* current_ = nullptr;
+    const Posting* end_ = nullptr;
+    Posting decoded_[POSTING_BLOCK_SIZE];
+
+    void LoadNext();
+};
+
+// Compressed posting list. Postings that arrive in id order collect in an uncompressed
+// tail until it fills a block, other changes re-encode the one block they touch
+class PostingList {
+public:
+    PostingList() = default;
+
+    // Encodes postings sorted by document id. A list shorter than a block keeps the vector as its tail
+    explicit PostingList(std::vector<Posting> postings);
+
+    PostingView GetView() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // The document must not be in the list yet
+    void Add(const Posting& posting);
+
+    bool Erase(int document_id);
+
+    // Appends postings with ids above the ones in the list. Blocks of the view are copied
+    // without being decoded, only the tail of the list is packed with the first of them
+    void Append(const PostingView& postings);
+
+    // Removes the postings for which is_removed(const Posting&) is true in one pass. Blocks without
+    // such postings keep their packed data, the rest of neighbouring changed blocks are packed together
+    template <typename Predicate>
+    size_t EraseIf(Predicate is_removed);
+
+private:
+    std::vector<PostingBlock> blocks_;
+    std::vector<uint8_t> data_;
+    std::vector<Posting> tail_;
+    size_t size_ = 0;
+
+    // Replaces blocks [first, last) and their data with blocks encoding the given postings
+    void ReplaceBlocks(size_t first, size_t last, const std::vector<Posting>& postings);
+
+    // Index of the first block whose last id is not less than the given one
+    size_t FindBlock(int document_id) const;
+};
+
+// Packs postings into blocks appended to the given arrays, data offsets are counted from data.begin().
+// Offsets are 32-bit, std::length_error is thrown once data reaches past 4 GiB
+void EncodePostingBlocks(const Posting* first, const Posting* last, std::vector<PostingBlock>& blocks, std::vector<uint8_t>& data);
+
+// Checks that the bit widths and the packed data of a block read from a file fit the data size
+bool IsValidPostingBlock(const PostingBlock& block, size_t data_size);
+
+// Checks that every ordinal of a valid block is below ordinal_count
+bool AreBlockOrdinalsBelow(const PostingBlock& block, const uint8_t* data, size_t ordinal_count);
+
+// Bytes of packed data of the block
+size_t GetPackedBlockSize(const PostingBlock& block);
+
+// Unpacks the block into output, which must have room for POSTING_BLOCK_SIZE postings
+void DecodePostingBlock(const PostingBlock& block, const uint8_t* data, Posting* output);
+
+template <typename Function>
+void PostingView::ForEach(Function function, int first_id, int64_t last_id) const {
+    // Blocks that end before the range are skipped without being decoded
+    const PostingBlock* block = std::partition_point(blocks_, blocks_ + block_count_, [first_id](const PostingBlock& block) {
+        return block.last_document_id < first_id;
+        });
+    Posting decoded[POSTING_BLOCK_SIZE];
+    for (; block != blocks_ + block_count_; ++block) {
+        if (block->first_document_id >= last_id) {
+            return;
+        }
+        DecodePostingBlock(*block, data_, decoded);
+        for (const Posting* posting = decoded; posting != decoded + block->size; ++posting) {
+            if (posting->document_id >= first_id && posting->document_id < last_id) {
+                function(*posting);
+            }
+        }
+    }
+    for (const Posting* posting = tail_; posting != tail_ + tail_size_; ++posting) {
+        if (posting->document_id >= last_id) {
+            return;
+        }
+        if (posting->document_id >= first_id) {
+            function(*posting);
+        }
+    }
+}
+
+template <typename Predicate>
+size_t PostingList::EraseIf(Predicate is_removed) {
+    std::vector<PostingBlock> new_blocks;
+    std::vector<uint8_t> new_data;
+    std::vector<Posting> kept;
+    Posting decoded[POSTING_BLOCK_SIZE];
+    size_t erased = 0;
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        const PostingBlock& block = blocks_[i];
+        DecodePostingBlock(block, data_.data(), decoded);
+        const size_t kept_before = kept.size();
+        std::remove_copy_if(decoded, decoded + block.size, std::back_inserter(kept), is_removed);
+        if (kept.size() - kept_before != block.size) {
+            erased += block.size - (kept.size() - kept_before);
+            continue;
+        }
+        kept.resize(kept_before);
+        EncodePostingBlocks(kept.data(), kept.data() + kept.size(), new_blocks, new_data);
+        kept.clear();
+        const size_t data_end = i + 1 < blocks_.size() ? blocks_[i + 1].data_offset : data_.size() - POSTING_DATA_PADDING;
+        new_blocks.push_back(block);
+        new_blocks.back().data_offset = static_cast<uint32_t>(new_data.size());
+        new_data.insert(new_data.end(), data_.begin() + block.data_offset, data_.begin() + data_end);
+    }
+    if (erased > 0) {
+        EncodePostingBlocks(kept.data(), kept.data() + kept.size(), new_blocks, new_data);
+        if (!new_blocks.empty()) {
+            new_data.resize(new_data.size() + POSTING_DATA_PADDING, 0);
+        }
+        blocks_ = std::move(new_blocks);
+        data_ = std::move(new_data);
+    }
+    const size_t tail_size = tail_.size();
+    tail_.erase(std::remove_if(tail_.begin(), tail_.end(), is_removed), tail_.end());
+    erased += tail_size - tail_.size();
+    size_ -= erased;
+    return erased;
+}
\ No newline at end of file
@@ -3,19 +3,54 @@
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
-    std::vector<std::vector<Document>> result(queries.size());
-    std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(),[&](const std::string& query) {
-        return search_server.FindTopDocuments(query);
-        });
-    return result;
+    return search_server.FindTopDocumentsBatch(std::execution::par, queries);
+}
+
+JoinedDocuments::JoinedDocuments(std::vector<Document> documents, std::vector<size_t> offsets)
+    : documents_(std::move(documents))
+    , offsets_(std::move(offsets))
+{
+}
+
+std::vector<Document>::const_iterator JoinedDocuments::begin() const {
+    return documents_.begin();
+}
+
+std::vector<Document>::const_iterator JoinedDocuments::end() const {
+    return documents_.end();
 }
 
-std::list<Document> ProcessQueriesJoined(
+size_t JoinedDocuments::size() const {
+    return documents_.size();
+}
+
+size_t JoinedDocuments::GetQueryCount() const {
+    return offsets_.size() - 1;
+}
+
+std::pair<std::vector<Document>::const_iterator, std::vector<Document>::const_iterator> JoinedDocuments::GetQueryDocuments(size_t query_index) const {
+    return { documents_.begin() + offsets_[query_index], documents_.begin() + offsets_[query_index + 1] };
+}
+
+JoinedDocuments ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
-    std::list<Document> result;
-    for (auto& document : ProcessQueries(search_server, queries)) {
-        result.insert(result.end(), document.begin(), document.end());
+    // Every query owns a fixed window of the buffer while the workers fill it,
+    // the windows are then moved together, so the buffer is allocated once
+    std::vector<Document> documents(queries.size() * MAX_RESULT_DOCUMENT_COUNT);
+    std::vector<size_t> counts(queries.size());
+    search_server.FindTopDocumentsBatch(std::execution::par, queries, [&](size_t query_index, std::vector<Document>&& found) {
+        std::copy(found.begin(), found.end(), documents.begin() + query_index * MAX_RESULT_DOCUMENT_COUNT);
+        counts[query_index] = found.size();
+        });
+    std::vector<size_t> offsets(queries.size() + 1);
+    for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
+        const size_t window = query_index * MAX_RESULT_DOCUMENT_COUNT;
+        if (offsets[query_index] != window) {
+            std::copy(documents.begin() + window, documents.begin() + window + counts[query_index], documents.begin() + offsets[query_index]);
+        }
+        offsets[query_index + 1] = offsets[query_index] + counts[query_index];
     }
-    return result;
-}
+    documents.resize(offsets.back());
+    return JoinedDocuments(std::move(documents), std::move(offsets));
+}
\ No newline at end of file
@@ -3,12 +3,45 @@
 
 #include <algorithm>
 #include <execution>
-#include <list>
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
-std::list<Document> ProcessQueriesJoined(
+// Found documents of all queries in one buffer, in the order of the queries
+class JoinedDocuments {
+public:
+    JoinedDocuments(std::vector<Document> documents, std::vector<size_t> offsets);
+
+    std::vector<Document>::const_iterator begin() const;
+
+    std::vector<Document>::const_iterator end() const;
+
+    size_t size() const;
+
+    size_t GetQueryCount() const;
+
+    // Documents found by the query with the given index
+    std::pair<std::vector<Document>::const_iterator, std::vector<Document>::const_iterator> GetQueryDocuments(size_t query_index) const;
+
+private:
+    std::vector<Document> documents_;
+    // Documents of query i are documents_[offsets_[i]] .. documents_[offsets_[i + 1]]
+    std::vector<size_t> offsets_;
+};
+
+JoinedDocuments ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+// Calls callback(query_index, const std::vector<Document>& documents) for every query as soon as
+// its results are ready, nothing is collected. The callback is called from several threads at once
+template <typename Callback>
+void ProcessQueriesStreaming(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries,
+    Callback callback) {
+    search_server.FindTopDocumentsBatch(std::execution::par, queries, [&callback](size_t query_index, std::vector<Document>&& documents) {
+        callback(query_index, static_cast<const std::vector<Document>&>(documents));
+        });
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "query_result_cache.h"
+
+QueryResultCache::QueryResultCache(const SearchServer& search_server, size_t capacity)
+    : search_server_(search_server)
+    , capacity_(capacity)
+    , generation_(search_server.GetGeneration())
+{
+    entries_.reserve(capacity_);
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(const std::string_view raw_query, DocumentStatus status, size_t max_document_count) {
+    return FindOrSearch(raw_query, status, max_document_count, [&]() {
+        return search_server_.FindTopDocuments(raw_query, status, max_document_count);
+        });
+}
+
+double QueryResultCache::Statistics::GetHitRate() const {
+    const uint64_t lookup_count = hit_count + miss_count;
+    return lookup_count == 0 ? 0.0 : static_cast<double>(hit_count) / lookup_count;
+}
+
+QueryResultCache::Statistics QueryResultCache::GetStatistics() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return statistics_;
+}
+
+bool QueryResultCache::Key::operator==(const Key& other) const {
+    return query == other.query && status == other.status && max_document_count == other.max_document_count;
+}
+
+size_t QueryResultCache::KeyHasher::operator()(const Key& key) const {
+    uint64_t hash = static_cast<uint64_t>(key.status) * 37 + key.max_document_count;
+    for (const TermId term_id : key.query) {
+        hash = hash * 0x100000001b3ULL ^ term_id;
+    }
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+bool QueryResultCache::Find(const Key& key, uint64_t generation, std::vector<Document>& documents) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (generation > generation_) {
+        entries_.clear();
+        entry_indexes_.clear();
+        clock_hand_ = 0;
+        generation_ = generation;
+    }
+    const auto it = generation == generation_ ? entry_indexes_.find(key) : entry_indexes_.end();
+    if (it == entry_indexes_.end()) {
+        ++statistics_.miss_count;
+        return false;
+    }
+    ++statistics_.hit_count;
+    Entry& entry = entries_[it->second];
+    entry.referenced = true;
+    documents = entry.documents;
+    return true;
+}
+
+void QueryResultCache::Insert(Key&& key, uint64_t generation, const std::vector<Document>& documents) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    // Another thread may have stored the same query while this one was searching
+    if (capacity_ == 0 || generation != generation_ || entry_indexes_.count(key) > 0) {
+        return;
+    }
+    if (entries_.size() < capacity_) {
+        entry_indexes_.emplace(key, entries_.size());
+        entries_.push_back({ std::move(key), documents, false });
+        return;
+    }
+    while (entries_[clock_hand_].referenced) {
+        entries_[clock_hand_].referenced = false;
+        clock_hand_ = (clock_hand_ + 1) % entries_.size();
+    }
+    Entry& entry = entries_[clock_hand_];
+    entry_indexes_.erase(entry.key);
+    entry_indexes_.emplace(key, clock_hand_);
+    entry = { std::move(key), documents, false };
+    clock_hand_ = (clock_hand_ + 1) % entries_.size();
+}
\ No newline at end of file
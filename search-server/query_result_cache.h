@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "search_server.h"
+
+// Bounded cache of FindTopDocuments results by status for a server that gets the same queries
+// over and over. Queries are keyed in normalized form, so word order, repeated words and words
+// missing from the index don't matter, and all entries are dropped once the server's generation
+// changes. A full cache evicts by the CLOCK algorithm: hits mark entries, and the hand clears
+// the marks as it passes and takes the first unmarked entry. Several threads may search
+// through one cache while the server doesn't change
+class QueryResultCache {
+public:
+    QueryResultCache(const SearchServer& search_server, size_t capacity);
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    // A miss is searched with the given policy
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    struct Statistics {
+        uint64_t hit_count = 0;
+        uint64_t miss_count = 0;
+
+        // Share of the lookups that were hits, 0 before the first lookup
+        double GetHitRate() const;
+    };
+
+    Statistics GetStatistics() const;
+
+private:
+    struct Key {
+        std::vector<TermId> query;
+        DocumentStatus status;
+        size_t max_document_count;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHasher {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<Document> documents;
+        bool referenced;
+    };
+
+    const SearchServer& search_server_;
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    // Generation of the server the entries were found in
+    uint64_t generation_;
+    std::vector<Entry> entries_;
+    std::unordered_map<Key, size_t, KeyHasher> entry_indexes_;
+    size_t clock_hand_ = 0;
+    Statistics statistics_;
+
+    // The search runs outside the lock, so threads that miss search concurrently
+    template <typename Search>
+    std::vector<Document> FindOrSearch(const std::string_view raw_query, DocumentStatus status, size_t max_document_count, Search search);
+
+    // Generations of a server only grow, so a newer one drops the entries. A thread that read
+    // the generation before the last change misses without touching entries of the newer one
+    bool Find(const Key& key, uint64_t generation, std::vector<Document>& documents);
+
+    // Results found in an older generation are not stored
+    void Insert(Key&& key, uint64_t generation, const std::vector<Document>& documents);
+};
+
+template <typename ExecutionPolicy>
+std::vector<Document> QueryResultCache::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status,
+    size_t max_document_count) {
+    return FindOrSearch(raw_query, status, max_document_count, [&]() {
+        return search_server_.FindTopDocuments(policy, raw_query, status, max_document_count);
+        });
+}
+
+template <typename Search>
+std::vector<Document> QueryResultCache::FindOrSearch(const std::string_view raw_query, DocumentStatus status, size_t max_document_count, Search search) {
+    Key key{ search_server_.GetQueryKey(raw_query), status, max_document_count };
+    const uint64_t generation = search_server_.GetGeneration();
+    std::vector<Document> documents;
+    if (!Find(key, generation, documents)) {
+        documents = search();
+        Insert(std::move(key), generation, documents);
+    }
+    return documents;
+}
\ No newline at end of file
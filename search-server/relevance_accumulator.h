@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Relevance scratch for a group of queries scored together. The slots of one document
+// are adjacent, so a posting shared by several queries of the group touches one cache line.
+class GroupRelevanceAccumulator {
+public:
+    static constexpr size_t GROUP_SIZE = 8;
+
+    void Prepare(size_t ordinal_count) {
+        if (state_.size() < ordinal_count * GROUP_SIZE) {
+            state_.resize(ordinal_count * GROUP_SIZE, EMPTY);
+            relevance_.resize(ordinal_count * GROUP_SIZE);
+        }
+    }
+
+    void Exclude(size_t slot, uint32_t ordinal) {
+        const size_t index = ordinal * GROUP_SIZE + slot;
+        if (state_[index] == EMPTY) {
+            touched_[slot].push_back(ordinal);
+        }
+        state_[index] = EXCLUDED;
+    }
+
+    void Add(size_t slot, uint32_t ordinal, double relevance) {
+        const size_t index = ordinal * GROUP_SIZE + slot;
+        char& state = state_[index];
+        if (state == SCORED) {
+            relevance_[index] += relevance;
+        }
+        else if (state == EMPTY) {
+            state = SCORED;
+            relevance_[index] = relevance;
+            touched_[slot].push_back(ordinal);
+        }
+    }
+
+    // Calls function(ordinal) once for every document touched by any slot
+    template <typename Function>
+    void ForEachTouched(Function function) const {
+        for (size_t slot = 0; slot < GROUP_SIZE; ++slot) {
+            for (const uint32_t ordinal : touched_[slot]) {
+                const char* const states = &state_[ordinal * GROUP_SIZE];
+                if (std::all_of(states, states + slot, [](char state) { return state == EMPTY; })) {
+                    function(ordinal);
+                }
+            }
+        }
+    }
+
+    bool IsScored(size_t slot, uint32_t ordinal) const {
+        return state_[ordinal * GROUP_SIZE + slot] == SCORED;
+    }
+
+    double GetRelevance(size_t slot, uint32_t ordinal) const {
+        return relevance_[ordinal * GROUP_SIZE + slot];
+    }
+
+    void Clear() {
+        for (size_t slot = 0; slot < GROUP_SIZE; ++slot) {
+            for (const uint32_t ordinal : touched_[slot]) {
+                state_[ordinal * GROUP_SIZE + slot] = EMPTY;
+            }
+            touched_[slot].clear();
+        }
+    }
+
+private:
+    static constexpr char EMPTY = 0;
+    static constexpr char SCORED = 1;
+    static constexpr char EXCLUDED = 2;
+
+    std::vector<double> relevance_;
+    std::vector<char> state_;
+    std::vector<uint32_t> touched_[GROUP_SIZE];
+
+    template <typename Accumulator>
+    friend class ThreadAccumulator;
+    bool in_use_ = false;
+};
+
+// Borrows the accumulator of the calling thread for one scoring pass.
+// A reentrant call on the same thread gets a private instance instead.
+template <typename Accumulator>
+class ThreadAccumulator {
+public:
+    explicit ThreadAccumulator(size_t ordinal_count) {
+        thread_local Accumulator shared;
+        if (shared.in_use_) {
+            owned_ = std::make_unique<Accumulator>();
+            accumulator_ = owned_.get();
+        }
+        else {
+            accumulator_ = &shared;
+        }
+        accumulator_->in_use_ = true;
+        accumulator_->Prepare(ordinal_count);
+    }
+
+    ThreadAccumulator(const ThreadAccumulator&) = delete;
+    ThreadAccumulator& operator=(const ThreadAccumulator&) = delete;
+
+    ~ThreadAccumulator() {
+        accumulator_->Clear();
+        accumulator_->in_use_ = false;
+    }
+
+    Accumulator* operator->() {
+        return accumulator_;
+    }
+
+private:
+    std::unique_ptr<Accumulator> owned_;
+    Accumulator* accumulator_;
+};
\ No newline at end of file
@@ -1,27 +1,145 @@
 #include "remove_duplicates.h"
-#include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server) {
-	std::map<std::set<std::string_view>, int> doc_set_id;
-	std::vector<int> id_for_remove;
-	for (const int document_id : search_server) {
-		auto words_in_document = search_server.GetWordFrequencies(document_id);
-		std::set<std::string_view> words;
-		for (const auto& [word, freq] : words_in_document) {
-			words.insert(word);
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "document_fingerprint.h"
+
+namespace {
+
+// Length of a MinHash signature, it is cut into bands of equal length
+constexpr size_t MIN_HASH_COUNT = 64;
+
+// Probability that documents exactly at the similarity threshold share at least one band
+constexpr double MIN_CANDIDATE_PROBABILITY = 0.99;
+
+// Longer bands give fewer false candidates, so the longest band that still keeps the probability is taken
+size_t ChooseBandLength(double min_similarity) {
+	size_t band_length = 1;
+	for (size_t length = 1; length <= MIN_HASH_COUNT; ++length) {
+		const double band_count = static_cast<double>(MIN_HASH_COUNT / length);
+		const double miss_probability = std::pow(1.0 - std::pow(min_similarity, static_cast<double>(length)), band_count);
+		if (1.0 - miss_probability >= MIN_CANDIDATE_PROBABILITY) {
+			band_length = length;
+		}
+	}
+	return band_length;
+}
+
+// The i-th hash of a term mixes the term's hash with the i-th seed. Shifted copies of one hash
+// would order the terms almost alike, while the band probabilities need independent hashes
+void ComputeMinHashSignature(const DocumentTermIds& term_ids, std::vector<uint64_t>& signature) {
+	signature.assign(MIN_HASH_COUNT, std::numeric_limits<uint64_t>::max());
+	for (const TermId term_id : term_ids) {
+		const uint64_t hash = HashTermId(term_id, 0xa4093822299f31d0ULL);
+		for (size_t i = 0; i < MIN_HASH_COUNT; ++i) {
+			signature[i] = std::min(signature[i], MixBits(hash ^ (i + 1) * 0x9e3779b97f4a7c15ULL));
+		}
+	}
+}
+
+double ComputeJaccardSimilarity(const DocumentTermIds& lhs, const DocumentTermIds& rhs) {
+	if (lhs.empty() && rhs.empty()) {
+		return 1.0;
+	}
+	size_t common_count = 0;
+	for (auto left = lhs.begin(), right = rhs.begin(); left != lhs.end() && right != rhs.end();) {
+		if (*left < *right) {
+			++left;
 		}
-		if (doc_set_id.count(words) > 0) {
-			int id_remove = (document_id < doc_set_id[words]) ? doc_set_id[words] : document_id;
-			doc_set_id[words] = (document_id < doc_set_id[words]) ? document_id : doc_set_id[words];
-			id_for_remove.push_back(id_remove);
+		else if (*right < *left) {
+			++right;
 		}
 		else {
-			doc_set_id[words] = document_id;
+			++common_count;
+			++left;
+			++right;
 		}
 	}
-	
-	for (int id : id_for_remove) {
+	return static_cast<double>(common_count) / static_cast<double>(lhs.size() + rhs.size() - common_count);
+}
+
+template <typename ExecutionPolicy>
+void RemoveFoundDuplicates(ExecutionPolicy policy, SearchServer& search_server) {
+	const std::vector<int> duplicate_ids = FindDuplicates(search_server);
+	for (const int id : duplicate_ids) {
 		std::cout << "Found duplicate document id " << id << std::endl;
-		search_server.RemoveDocument(id);
 	}
+	search_server.RemoveDocuments(policy, duplicate_ids);
+}
+
+}  // namespace
+
+std::vector<int> FindDuplicates(const SearchServer& search_server) {
+	// Documents are duplicates when their sets of word ids are equal. Word sets of documents
+	// with equal fingerprints are compared as well, so a collision can't remove a document
+	std::unordered_map<DocumentFingerprint, int, DocumentFingerprintHasher> first_ids;
+	std::vector<int> duplicate_ids;
+	for (const int document_id : search_server) {
+		const auto [it, inserted] = first_ids.emplace(search_server.GetDocumentFingerprint(document_id), document_id);
+		if (!inserted && search_server.GetDocumentTermIds(document_id) == search_server.GetDocumentTermIds(it->second)) {
+			duplicate_ids.push_back(document_id);
+		}
+	}
+	return duplicate_ids;
+}
+
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, double min_similarity) {
+	if (!(min_similarity > 0.0 && min_similarity <= 1.0)) {
+		throw std::invalid_argument("      0    1");
+	}
+	const size_t band_length = ChooseBandLength(min_similarity);
+	const size_t band_count = MIN_HASH_COUNT / band_length;
+	// Kept documents by the hash of every band of their signatures
+	std::vector<std::unordered_map<uint64_t, std::vector<int>>> band_documents(band_count);
+	std::vector<uint64_t> signature;
+	std::vector<uint64_t> band_keys(band_count);
+	std::vector<int> candidate_ids;
+	std::vector<int> duplicate_ids;
+	for (const int document_id : search_server) {
+		const DocumentTermIds term_ids = search_server.GetDocumentTermIds(document_id);
+		ComputeMinHashSignature(term_ids, signature);
+		candidate_ids.clear();
+		for (size_t band = 0; band < band_count; ++band) {
+			uint64_t key = band;
+			for (size_t i = band * band_length; i < (band + 1) * band_length; ++i) {
+				key = (key ^ signature[i]) * 0x100000001b3ULL;
+			}
+			band_keys[band] = key;
+			const auto it = band_documents[band].find(key);
+			if (it != band_documents[band].end()) {
+				candidate_ids.insert(candidate_ids.end(), it->second.begin(), it->second.end());
+			}
+		}
+		std::sort(candidate_ids.begin(), candidate_ids.end());
+		candidate_ids.erase(std::unique(candidate_ids.begin(), candidate_ids.end()), candidate_ids.end());
+		const bool is_duplicate = std::any_of(candidate_ids.begin(), candidate_ids.end(), [&](int candidate_id) {
+			return ComputeJaccardSimilarity(term_ids, search_server.GetDocumentTermIds(candidate_id)) >= min_similarity;
+			});
+		if (is_duplicate) {
+			duplicate_ids.push_back(document_id);
+			continue;
+		}
+		for (size_t band = 0; band < band_count; ++band) {
+			band_documents[band][band_keys[band]].push_back(document_id);
+		}
+	}
+	return duplicate_ids;
+}
+
+void RemoveDuplicates(SearchServer& search_server) {
+	RemoveFoundDuplicates(std::execution::seq, search_server);
+}
+
+void RemoveDuplicates(std::execution::sequenced_policy seq, SearchServer& search_server) {
+	RemoveFoundDuplicates(seq, search_server);
+}
+
+void RemoveDuplicates(std::execution::parallel_policy par, SearchServer& search_server) {
+	RemoveFoundDuplicates(par, search_server);
 }
\ No newline at end of file
@@ -1,5 +1,21 @@
 #pragma once
+#include <execution>
+#include <vector>
+
 #include "search_server.h"
 
+// Ids of the documents whose set of words equals that of a document with a smaller id, in increasing order
+std::vector<int> FindDuplicates(const SearchServer& search_server);
+
+// Ids of the documents whose sets of words have a Jaccard similarity of at least min_similarity
+// with a kept document of a smaller id, in increasing order. Candidates come from MinHash signatures
+// split into LSH bands and are checked exactly, a pair right at the threshold is missed
+// with a probability of at most 1%. Exact duplicates are always found
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, double min_similarity);
+
+// Prints and removes the documents found by FindDuplicates, all of them in one batch
+void RemoveDuplicates(SearchServer& search_server);
+
+void RemoveDuplicates(std::execution::sequenced_policy seq, SearchServer& search_server);
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+void RemoveDuplicates(std::execution::parallel_policy par, SearchServer& search_server);
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "search_server.h"
 
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
 //inline constexpr int SearchServer::INVALID_DOCUMENT_ID = -1;
 
 
@@ -17,153 +21,659 @@ void SearchServer::AddDocument(int document_id, const std::string_view document,
     if (document_id < 0) {
         throw std::invalid_argument("     id = " + std::to_string(document_id));
     }
-    if (documents_.count(document_id) > 0) {
+    if (document_ordinals_.count(document_id) > 0) {
         throw std::invalid_argument("      id = " + std::to_string(document_id));
     }
+    if (static_cast<size_t>(status) >= DOCUMENT_STATUS_COUNT) {
+        throw std::invalid_argument("    id = " + std::to_string(document_id));
+    }
 
-    documents_.emplace(document_id,
-        DocumentData{
-            std::string(document),
-            ComputeAverageRating(ratings),
-            status
-        });
+    // Words are validated before anything is stored
+    std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(document, words);
+    // A posting list can't hold two postings of one id
+    if (removed_documents_.count(document_id) > 0) {
+        PurgeRemoved(std::execution::seq);
+    }
+    std::vector<TermId> word_term_ids;
+    word_term_ids.reserve(words.size());
+    for (const std::string_view word : words) {
+        word_term_ids.push_back(index_.AddWord(word));
+    }
+    std::sort(word_term_ids.begin(), word_term_ids.end());
 
-    const std::vector<std::string_view> words = SplitIntoWordsNoStop(documents_[document_id].text_doc);
-    const double inv_word_count = 1.0 / words.size();
-    for (const std::string_view& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+    DocumentData document_data{
+        ComputeAverageRating(ratings),
+        status,
+        AcquireOrdinal(document_id, 1.0 / words.size()),
+        {}
+    };
+    const double inv_word_count = inverse_word_counts_[document_data.ordinal];
+    for (auto it = word_term_ids.begin(); it != word_term_ids.end();) {
+        const auto run_end = std::upper_bound(it, word_term_ids.end(), *it);
+        const uint32_t count = static_cast<uint32_t>(run_end - it);
+        index_.AddPosting(*it, document_id, document_data.ordinal, count, count * inv_word_count);
+        document_data.terms.push_back({ *it, count });
+        it = run_end;
     }
+    index_.SealBufferIfFull();
+    StoreDocument(document_id, std::move(document_data));
+    OnDocumentsChanged();
+}
 
-    document_ids_.insert(document_id);
+void SearchServer::AddDocuments(const std::vector<NewDocument>& documents) {
+    InsertDocuments(std::execution::seq, documents);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status_input) const {
-    return FindTopDocuments(raw_query, [status_input](int id, DocumentStatus status, int rating) {
-        return status == status_input;
-        });
+void SearchServer::AddDocuments(std::execution::sequenced_policy seq, const std::vector<NewDocument>& documents) {
+    InsertDocuments(seq, documents);
+}
+
+void SearchServer::AddDocuments(std::execution::parallel_policy par, const std::vector<NewDocument>& documents) {
+    InsertDocuments(par, documents);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status_input,
+    size_t max_document_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status_input, max_document_count);
+}
+
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, const std::string_view raw_query,
+    DocumentStatus status_input, size_t max_document_count) const {
+    auto filter_function = [](int id, DocumentStatus status, int rating) {
+        return true;
+    };
+    FindAllDocuments(std::execution::seq, context, raw_query, filter_function, max_document_count, &GetStatusOrdinals(status_input));
+    return context.documents_;
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const {
-    return FindTopDocuments(raw_query, [](int id, DocumentStatus status, int rating) {
-        return status == DocumentStatus::ACTUAL;
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::CompiledQuery SearchServer::CompileQuery(const std::string_view raw_query) const {
+    CompiledQuery query;
+    ResolveQuery(raw_query, query);
+    return query;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const CompiledQuery& query, DocumentStatus status_input,
+    size_t max_document_count) const {
+    return FindTopDocuments(std::execution::seq, query, status_input, max_document_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const CompiledQuery& query) const {
+    return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const {
+    return FindTopDocumentsBatch(std::execution::seq, raw_queries);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(std::execution::sequenced_policy seq, const std::vector<std::string>& raw_queries) const {
+    std::vector<std::vector<Document>> results(raw_queries.size());
+    FindTopDocumentsBatch(seq, raw_queries, [&results](size_t query_index, std::vector<Document>&& documents) {
+        results[query_index] = std::move(documents);
         });
+    return results;
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(std::execution::parallel_policy par, const std::vector<std::string>& raw_queries) const {
+    std::vector<std::vector<Document>> results(raw_queries.size());
+    FindTopDocumentsBatch(par, raw_queries, [&results](size_t query_index, std::vector<Document>&& documents) {
+        results[query_index] = std::move(documents);
+        });
+    return results;
+}
+
+SearchServer::QueryBatch SearchServer::ParseQueryBatch(const std::vector<std::string>& raw_queries) const {
+    QueryBatch batch;
+    batch.queries.reserve(raw_queries.size());
+    for (const std::string& raw_query : raw_queries) {
+        batch.queries.push_back(ParseQuery(raw_query));
+    }
+    // Queries with the same words end up next to each other and likely in one group
+    batch.order.resize(batch.queries.size());
+    std::iota(batch.order.begin(), batch.order.end(), 0);
+    std::sort(batch.order.begin(), batch.order.end(), [&batch](size_t lhs, size_t rhs) {
+        return batch.queries[lhs].plus_terms < batch.queries[rhs].plus_terms;
+        });
+    for (size_t start = 0; start < batch.order.size(); start += GroupRelevanceAccumulator::GROUP_SIZE) {
+        batch.group_starts.push_back(start);
+    }
+    return batch;
+}
+
+std::vector<TopDocuments> SearchServer::ScoreQueryGroup(const std::vector<Query>& queries, const size_t* first, const size_t* last) const {
+    const size_t query_count = last - first;
+    std::vector<TopDocuments> top_documents(query_count, TopDocuments(MAX_RESULT_DOCUMENT_COUNT));
+    ThreadAccumulator<GroupRelevanceAccumulator> accumulator(ordinal_to_document_id_.size());
+    QueryContext& context = GetThreadQueryContext();
+    auto filter_function = [](int document_id, DocumentStatus status, int rating) {
+        return true;
+    };
+    // (term, is plus, query slot): terms go in increasing id order, as in FindAllDocuments,
+    // so every document gets its relevance summed in the same order
+    std::vector<std::tuple<TermId, bool, uint32_t>> term_uses;
+    for (size_t slot = 0; slot < query_count; ++slot) {
+        const Query& query = queries[first[slot]];
+        if (query.plus_terms.size() <= MAX_PRUNED_BATCH_QUERY_TERMS) {
+            FindQueryPostings(query, context.segment_postings_);
+            FindTopDocumentsInRange(context.segment_postings_, 0, std::numeric_limits<int64_t>::max(), filter_function,
+                &GetStatusOrdinals(DocumentStatus::ACTUAL), context.evaluator_, top_documents[slot]);
+            continue;
+        }
+        for (const TermId term_id : query.plus_terms) {
+            term_uses.emplace_back(term_id, true, static_cast<uint32_t>(slot));
+        }
+        for (const TermId term_id : query.minus_terms) {
+            term_uses.emplace_back(term_id, false, static_cast<uint32_t>(slot));
+        }
+    }
+    std::sort(term_uses.begin(), term_uses.end());
+    std::vector<uint32_t> minus_slots;
+    std::vector<uint32_t> plus_slots;
+    for (auto it = term_uses.begin(); it != term_uses.end();) {
+        const TermId term_id = std::get<0>(*it);
+        minus_slots.clear();
+        plus_slots.clear();
+        for (; it != term_uses.end() && std::get<0>(*it) == term_id; ++it) {
+            (std::get<1>(*it) ? plus_slots : minus_slots).push_back(std::get<2>(*it));
+        }
+        const InvertedIndex::Term& term = index_.GetTerm(term_id);
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(term);
+        term.ForEachPosting([&](const Posting& posting) {
+            for (const uint32_t slot : minus_slots) {
+                accumulator->Exclude(slot, posting.document_ordinal);
+            }
+            const double term_freq = ComputeTermFreq(posting);
+            for (const uint32_t slot : plus_slots) {
+                accumulator->Add(slot, posting.document_ordinal, term_freq * inverse_document_freq);
+            }
+            });
+    }
+    // A document found by several queries of the group is looked up once
+    accumulator->ForEachTouched([&](uint32_t ordinal) {
+        if (!status_ordinals_[static_cast<size_t>(DocumentStatus::ACTUAL)].Test(ordinal)) {
+            return;
+        }
+        const int document_id = ordinal_to_document_id_[ordinal];
+        for (size_t slot = 0; slot < query_count; ++slot) {
+            if (accumulator->IsScored(slot, ordinal)) {
+                top_documents[slot].Add({ document_id, accumulator->GetRelevance(slot, ordinal), ratings_[ordinal] });
+            }
+        }
+        });
+    return top_documents;
 }
 
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return document_ordinals_.size();
 }
 
-std::set<int>::const_iterator SearchServer::begin() const {
-    return document_ids_.begin();
+SearchServer SearchServer::Clone() const {
+    SearchServer copy(*this);
+    copy.generation_ = TakeGeneration();
+    return copy;
 }
 
-std::set<int>::const_iterator SearchServer::end() const {
-    return document_ids_.end();
+uint64_t SearchServer::GetGeneration() const {
+    return generation_;
+}
+
+std::vector<TermId> SearchServer::GetQueryKey(const std::string_view raw_query) const {
+    const Query query = ParseQuery(raw_query);
+    std::vector<TermId> key = { static_cast<TermId>(query.plus_terms.size()) };
+    key.insert(key.end(), query.plus_terms.begin(), query.plus_terms.end());
+    key.insert(key.end(), query.minus_terms.begin(), query.minus_terms.end());
+    return key;
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static std::map<std::string_view, double> result;
-    if (documents_.count(document_id) == 0) {
-        return result;
+SearchServer::DocumentIdIterator SearchServer::begin() const {
+    return DocumentIdIterator(document_ordinals_.begin());
+}
+
+SearchServer::DocumentIdIterator SearchServer::end() const {
+    return DocumentIdIterator(document_ordinals_.end());
+}
+
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
+        return {};
     }
-    return document_to_word_freqs_.at(document_id);
+    const std::vector<DocumentTerm>& terms = document_terms_[it->second];
+    return WordFrequencies(index_, terms.data(), terms.data() + terms.size(), inverse_word_counts_[it->second]);
 }
 
 void SearchServer::RemoveDocument(std::execution::sequenced_policy seq, int document_id) {
-    SearchServer::RemoveDocument(document_id);
+    EraseDocuments(seq, &document_id, &document_id + 1);
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    auto it_to_id = find(std::execution::par, document_ids_.begin(), document_ids_.end(), document_id);
-    document_ids_.erase(it_to_id);
-    documents_.erase(document_id);
-    for (const auto& [word, _] : document_to_word_freqs_[document_id]) {
-        word_to_document_freqs_[word].erase(document_id);
-    }
-    document_to_word_freqs_.erase(document_id);
+    EraseDocuments(std::execution::seq, &document_id, &document_id + 1);
 }
 
 void SearchServer::RemoveDocument(std::execution::parallel_policy par, int document_id) {
-    auto it_to_id = find(std::execution::par, document_ids_.begin(), document_ids_.end(), document_id);
-    document_ids_.erase(it_to_id);
-    documents_.erase(document_id);
-    std::vector<const std::string_view*> words_in_id(document_to_word_freqs_[document_id].size());
-    std::transform(std::execution::par, document_to_word_freqs_[document_id].begin(), document_to_word_freqs_[document_id].end(), words_in_id.begin(), [](auto& word_freq) {
-        return &word_freq.first;
-        });
-    std::for_each(std::execution::par, words_in_id.begin(), words_in_id.end(), [&document_id, this](const std::string_view* ptr_word) {
-        word_to_document_freqs_[*ptr_word].erase(document_id);
-        });
-    document_to_word_freqs_.erase(document_id);
+    EraseDocuments(par, &document_id, &document_id + 1);
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    RemoveDocuments(std::execution::seq, document_ids);
+}
+
+void SearchServer::RemoveDocuments(std::execution::sequenced_policy seq, const std::vector<int>& document_ids) {
+    EraseDocuments(seq, document_ids.data(), document_ids.data() + document_ids.size());
+}
+
+void SearchServer::RemoveDocuments(std::execution::parallel_policy par, const std::vector<int>& document_ids) {
+    EraseDocuments(par, document_ids.data(), document_ids.data() + document_ids.size());
+}
+
+void SearchServer::PurgeRemovedDocuments() {
+    PurgeRemoved(std::execution::seq);
+}
+
+void SearchServer::PurgeRemovedDocuments(std::execution::sequenced_policy seq) {
+    PurgeRemoved(seq);
+}
+
+void SearchServer::PurgeRemovedDocuments(std::execution::parallel_policy par) {
+    PurgeRemoved(par);
+}
+
+DocumentTermIds SearchServer::GetDocumentTermIds(int document_id) const {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
+        return {};
+    }
+    const std::vector<DocumentTerm>& terms = document_terms_[it->second];
+    return DocumentTermIds(terms.data(), terms.data() + terms.size());
+}
+
+DocumentFingerprint SearchServer::GetDocumentFingerprint(int document_id) const {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
+        return {};
+    }
+    return fingerprints_[it->second];
+}
+
+bool SearchServer::MarkDocumentRemoved(int document_id) {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
+        return false;
+    }
+    const uint32_t ordinal = it->second;
+    // Queries skip the document by its ordinal, the term ids are kept to find its postings later
+    for (const DocumentTerm& term : document_terms_[ordinal]) {
+        index_.MarkDocumentRemoved(term.term_id);
+    }
+    status_ordinals_[static_cast<size_t>(statuses_[ordinal])].Reset(ordinal);
+    live_ordinals_.Reset(ordinal);
+    removed_documents_.emplace(document_id, ordinal);
+    document_ordinals_.erase(it);
+    return true;
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const {
+    SnapshotWriter writer(path);
+    writer.WriteStrings(std::vector<std::string_view>(stop_words_.begin(), stop_words_.end()));
+    index_.SaveSnapshot(writer, live_ordinals_);
+    writer.WriteArray(ordinal_to_document_id_);
+    writer.WriteArray(inverse_word_counts_);
+    // Removed documents are not written, so their ordinals are free in the snapshot
+    std::vector<uint32_t> free_ordinals = free_ordinals_;
+    for (const auto& [document_id, ordinal] : removed_documents_) {
+        free_ordinals.push_back(ordinal);
+    }
+    writer.WriteArray(free_ordinals);
+    std::vector<DocumentRecord> records;
+    records.reserve(document_ordinals_.size());
+    std::vector<DocumentTerm> terms;
+    for (const auto& [document_id, ordinal] : document_ordinals_) {
+        const std::vector<DocumentTerm>& document_terms = document_terms_[ordinal];
+        records.push_back({ document_id, ratings_[ordinal], statuses_[ordinal], ordinal, static_cast<uint32_t>(document_terms.size()) });
+        terms.insert(terms.end(), document_terms.begin(), document_terms.end());
+    }
+    writer.WriteArray(records);
+    writer.WriteArray(terms);
+    writer.Finish();
+}
+
+SearchServer SearchServer::LoadSnapshot(const std::string& path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    SnapshotReader reader(file->GetData(), file->GetSize());
+    SearchServer server;
+    for (const std::string_view stop_word : reader.ReadStrings()) {
+        server.stop_words_.emplace(stop_word);
+    }
+    server.index_.LoadSnapshot(reader, file);
+    const SnapshotArray<int> ordinal_to_document_id = reader.ReadArray<int>();
+    server.ordinal_to_document_id_.assign(ordinal_to_document_id.begin(), ordinal_to_document_id.end());
+    server.index_.CheckSnapshotOrdinals(ordinal_to_document_id.size);
+    const SnapshotArray<double> inverse_word_counts = reader.ReadArray<double>();
+    if (inverse_word_counts.size != ordinal_to_document_id.size) {
+        throw std::runtime_error("  ");
+    }
+    server.inverse_word_counts_.assign(inverse_word_counts.begin(), inverse_word_counts.end());
+    server.ratings_.resize(ordinal_to_document_id.size);
+    server.statuses_.resize(ordinal_to_document_id.size);
+    server.document_terms_.resize(ordinal_to_document_id.size);
+    server.fingerprints_.resize(ordinal_to_document_id.size);
+    // Every ordinal is either free or held by one document, a repeated one would be handed out twice
+    OrdinalBitmap used_ordinals;
+    const auto use_ordinal = [&used_ordinals, &ordinal_to_document_id](uint32_t ordinal) {
+        if (ordinal >= ordinal_to_document_id.size || used_ordinals.Test(ordinal)) {
+            throw std::runtime_error("  ");
+        }
+        used_ordinals.Set(ordinal);
+    };
+    const SnapshotArray<uint32_t> free_ordinals = reader.ReadArray<uint32_t>();
+    for (const uint32_t ordinal : free_ordinals) {
+        use_ordinal(ordinal);
+    }
+    server.free_ordinals_.assign(free_ordinals.begin(), free_ordinals.end());
+    const SnapshotArray<DocumentRecord> records = reader.ReadArray<DocumentRecord>();
+    const SnapshotArray<DocumentTerm> terms = reader.ReadArray<DocumentTerm>();
+    size_t first = 0;
+    int previous_id = INVALID_DOCUMENT_ID;
+    for (const DocumentRecord& record : records) {
+        use_ordinal(record.ordinal);
+        // Records go in increasing id order, which also keeps ids unique and non-negative
+        if (record.term_count > terms.size - first || static_cast<size_t>(record.status) >= DOCUMENT_STATUS_COUNT
+            || record.id <= previous_id || ordinal_to_document_id.data[record.ordinal] != record.id) {
+            throw std::runtime_error("  ");
+        }
+        previous_id = record.id;
+        // Term ids of a document must be known to the index and go in increasing order
+        for (size_t i = first; i < first + record.term_count; ++i) {
+            if (terms.data[i].term_id >= server.index_.GetTermIdCount()
+                || (i > first && terms.data[i].term_id <= terms.data[i - 1].term_id)) {
+                throw std::runtime_error("  ");
+            }
+        }
+        DocumentData document_data{
+            record.rating,
+            record.status,
+            record.ordinal,
+            std::vector<DocumentTerm>(terms.data + first, terms.data + first + record.term_count)
+        };
+        first += record.term_count;
+        server.StoreDocument(record.id, std::move(document_data));
+    }
+    server.OnDocumentsChanged();
+    return server;
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy seq, const std::string_view raw_query, int document_id) const {
     //LOG_DURATION("Operation time");
     const Query query = ParseQuery(raw_query);
-    std::vector<std::string_view> matched_words;
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    return MatchQuery(query, document_ordinals_.at(document_id));
+}
+
+// One document is matched by a single merge walk, there is nothing to split between threads
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy par, const std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(const std::string_view raw_query,
+    const std::vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(std::execution::sequenced_policy seq,
+    const std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchQueryBatch(seq, ParseQuery(raw_query), document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(std::execution::parallel_policy par,
+    const std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchQueryBatch(par, ParseQuery(raw_query), document_ids);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const CompiledQuery& query, int document_id) const {
+    return MatchDocument(std::execution::seq, query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy seq, const CompiledQuery& query, int document_id) const {
+    CompiledQuery recompiled;
+    return MatchQuery(GetCurrentQuery(query, recompiled).query_, document_ordinals_.at(document_id));
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy par, const CompiledQuery& query, int document_id) const {
+    return MatchDocument(std::execution::seq, query, document_id);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(const CompiledQuery& query,
+    const std::vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, query, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(std::execution::sequenced_policy seq,
+    const CompiledQuery& query, const std::vector<int>& document_ids) const {
+    CompiledQuery recompiled;
+    return MatchQueryBatch(seq, GetCurrentQuery(query, recompiled).query_, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(std::execution::parallel_policy par,
+    const CompiledQuery& query, const std::vector<int>& document_ids) const {
+    CompiledQuery recompiled;
+    return MatchQueryBatch(par, GetCurrentQuery(query, recompiled).query_, document_ids);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchQuery(const Query& query, uint32_t ordinal) const {
+    const std::vector<DocumentTerm>& terms = document_terms_[ordinal];
+    const DocumentStatus status = statuses_[ordinal];
+    const auto less = [](const DocumentTerm& term, TermId term_id) {
+        return term.term_id < term_id;
+    };
+    // Query terms go in increasing order, so each search starts where the previous one stopped
+    auto term = terms.begin();
+    for (const TermId term_id : query.minus_terms) {
+        term = std::lower_bound(term, terms.end(), term_id, less);
+        if (term == terms.end()) {
+            break;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            //matched_words.clear();
-            return { matched_words, documents_.at(document_id).status };
+        if (term->term_id == term_id) {
+            return { std::vector<std::string_view>{}, status };
         }
     }
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    std::vector<std::string_view> matched_words;
+    term = terms.begin();
+    for (const TermId term_id : query.plus_terms) {
+        term = std::lower_bound(term, terms.end(), term_id, less);
+        if (term == terms.end()) {
+            break;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word_to_document_freqs_.find(word)->first);
+        if (term->term_id == term_id) {
+            matched_words.push_back(index_.GetWord(term_id));
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    std::sort(matched_words.begin(), matched_words.end());
+    return { matched_words, status };
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy seq, const std::string_view raw_query, int document_id) const {
-    return MatchDocument(raw_query, document_id);
+uint32_t SearchServer::AcquireOrdinal(int document_id, double inverse_word_count) {
+    if (!free_ordinals_.empty()) {
+        const uint32_t ordinal = free_ordinals_.back();
+        free_ordinals_.pop_back();
+        ordinal_to_document_id_[ordinal] = document_id;
+        inverse_word_counts_[ordinal] = inverse_word_count;
+        return ordinal;
+    }
+    ordinal_to_document_id_.push_back(document_id);
+    inverse_word_counts_.push_back(inverse_word_count);
+    ratings_.emplace_back();
+    statuses_.emplace_back();
+    document_terms_.emplace_back();
+    fingerprints_.emplace_back();
+    return static_cast<uint32_t>(ordinal_to_document_id_.size() - 1);
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy par, const std::string_view raw_query, int document_id) const {
-    //LOG_DURATION("Operation time");
-    const QueryPar query = ParseQueryPar(raw_query);
-    bool flag =  std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [&](const std::string_view word) {
-        auto it = document_to_word_freqs_.find(document_id);
-        return it != document_to_word_freqs_.end() && it->second.count(word) != 0;
-        });
-    if (flag) {
-        return { {}, documents_.at(document_id).status };
+void SearchServer::StoreDocument(int document_id, DocumentData&& document) {
+    ratings_[document.ordinal] = document.rating;
+    statuses_[document.ordinal] = document.status;
+    DocumentFingerprint fingerprint;
+    for (const DocumentTerm& term : document.terms) {
+        fingerprint.AddTerm(term.term_id);
     }
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    
-    auto last = std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), [&](const std::string_view word) {
-        return word_to_document_freqs_.count(word) != 0 && word_to_document_freqs_.at(word).count(document_id);
+    fingerprints_[document.ordinal] = fingerprint;
+    document_terms_[document.ordinal] = std::move(document.terms);
+    status_ordinals_[static_cast<size_t>(document.status)].Set(document.ordinal);
+    live_ordinals_.Set(document.ordinal);
+    // Batches and snapshots store documents in increasing id order
+    document_ordinals_.emplace_hint(document_ordinals_.end(), document_id, document.ordinal);
+}
+
+const OrdinalBitmap& SearchServer::GetStatusOrdinals(DocumentStatus status) const {
+    static const OrdinalBitmap empty;
+    const size_t index = static_cast<size_t>(status);
+    return index < status_ordinals_.size() ? status_ordinals_[index] : empty;
+}
+
+double SearchServer::ComputeTermFreq(const Posting& posting) const {
+    return posting.count * inverse_word_counts_[posting.document_ordinal];
+}
+
+std::vector<SearchServer::BatchPart> SearchServer::SplitDocumentBatch(const std::vector<NewDocument>& documents, size_t part_count) const {
+    std::vector<size_t> order(documents.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&documents](size_t lhs, size_t rhs) {
+        return documents[lhs].id < documents[rhs].id;
         });
-        
-    matched_words.resize(std::distance(matched_words.begin(), last));
-    std::sort(matched_words.begin(), matched_words.end());
-    last = std::unique(std::execution::par, matched_words.begin(), matched_words.end());
-    matched_words.resize(std::distance(matched_words.begin(), last));
-    return { matched_words, documents_.at(document_id).status };
+    for (size_t i = 0; i < order.size(); ++i) {
+        const int document_id = documents[order[i]].id;
+        if (document_id < 0) {
+            throw std::invalid_argument("     id = " + std::to_string(document_id));
+        }
+        if (document_ordinals_.count(document_id) > 0 || (i > 0 && documents[order[i - 1]].id == document_id)) {
+            throw std::invalid_argument("      id = " + std::to_string(document_id));
+        }
+        if (static_cast<size_t>(documents[order[i]].status) >= DOCUMENT_STATUS_COUNT) {
+            throw std::invalid_argument("    id = " + std::to_string(document_id));
+        }
+    }
+    part_count = std::max<size_t>(1, std::min(part_count, order.size()));
+    std::vector<BatchPart> parts(part_count);
+    for (size_t part = 0; part < part_count; ++part) {
+        parts[part].positions.assign(order.begin() + order.size() * part / part_count, order.begin() + order.size() * (part + 1) / part_count);
+    }
+    return parts;
 }
 
-bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(word) > 0;
+void SearchServer::TokenizeBatchPart(const std::vector<NewDocument>& documents, BatchPart& part) const {
+    // An exception can't leave a parallel algorithm, it is passed to the caller afterwards
+    try {
+        std::unordered_map<std::string_view, uint32_t> word_indexes;
+        std::vector<uint32_t> document_word_indexes;
+        std::vector<std::string_view> words;
+        part.document_words.reserve(part.positions.size());
+        part.inverse_word_counts.reserve(part.positions.size());
+        for (const size_t position : part.positions) {
+            SplitIntoWordsNoStop(documents[position].text, words);
+            document_word_indexes.clear();
+            for (const std::string_view word : words) {
+                const auto [it, inserted] = word_indexes.emplace(word, static_cast<uint32_t>(part.words.size()));
+                if (inserted) {
+                    part.words.push_back(word);
+                }
+                document_word_indexes.push_back(it->second);
+            }
+            std::sort(document_word_indexes.begin(), document_word_indexes.end());
+            auto& document_words = part.document_words.emplace_back();
+            part.inverse_word_counts.push_back(1.0 / words.size());
+            for (auto it = document_word_indexes.begin(); it != document_word_indexes.end();) {
+                const auto run_end = std::upper_bound(it, document_word_indexes.end(), *it);
+                document_words.push_back({ *it, static_cast<uint32_t>(run_end - it) });
+                it = run_end;
+            }
+        }
+    }
+    catch (...) {
+        part.error = std::current_exception();
+    }
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("  \"" + std::string(word) + "\"  ");
+void SearchServer::InternBatchWords(const std::vector<NewDocument>& documents, std::vector<BatchPart>& parts) {
+    for (BatchPart& part : parts) {
+        part.term_ids.reserve(part.words.size());
+        for (const std::string_view word : part.words) {
+            part.term_ids.push_back(index_.AddWord(word));
+        }
+        part.ordinals.reserve(part.positions.size());
+        for (size_t i = 0; i < part.positions.size(); ++i) {
+            part.ordinals.push_back(AcquireOrdinal(documents[part.positions[i]].id, part.inverse_word_counts[i]));
         }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+    }
+}
+
+void SearchServer::IndexBatchPart(const std::vector<NewDocument>& documents, BatchPart& part) const {
+    part.postings.resize(part.words.size());
+    part.documents.reserve(part.positions.size());
+    for (size_t i = 0; i < part.positions.size(); ++i) {
+        const NewDocument& document = documents[part.positions[i]];
+        DocumentData document_data{
+            ComputeAverageRating(document.ratings),
+            document.status,
+            part.ordinals[i],
+            {}
+        };
+        document_data.terms.reserve(part.document_words[i].size());
+        for (const auto& [word_index, count] : part.document_words[i]) {
+            part.postings[word_index].push_back({ document.id, part.ordinals[i], count });
+            document_data.terms.push_back({ part.term_ids[word_index], count });
         }
+        std::sort(document_data.terms.begin(), document_data.terms.end(), [](const DocumentTerm& lhs, const DocumentTerm& rhs) {
+            return lhs.term_id < rhs.term_id;
+            });
+        part.documents.push_back(std::move(document_data));
     }
-    return words;
+}
+
+std::vector<std::pair<TermId, std::vector<std::vector<Posting>>>> SearchServer::CollectBatchPostings(std::vector<BatchPart>& parts) {
+    // (term id, part, index in the part's words), parts go in increasing id order
+    std::vector<std::tuple<TermId, size_t, uint32_t>> sources;
+    for (size_t part = 0; part < parts.size(); ++part) {
+        for (uint32_t word_index = 0; word_index < parts[part].term_ids.size(); ++word_index) {
+            sources.emplace_back(parts[part].term_ids[word_index], part, word_index);
+        }
+    }
+    std::sort(sources.begin(), sources.end());
+    std::vector<std::pair<TermId, std::vector<std::vector<Posting>>>> term_postings;
+    for (const auto& [term_id, part, word_index] : sources) {
+        if (term_postings.empty() || term_postings.back().first != term_id) {
+            term_postings.emplace_back(term_id, std::vector<std::vector<Posting>>{});
+        }
+        term_postings.back().second.push_back(std::move(parts[part].postings[word_index]));
+    }
+    return term_postings;
+}
+
+void SearchServer::StoreBatchDocuments(const std::vector<NewDocument>& documents, std::vector<BatchPart>& parts) {
+    for (BatchPart& part : parts) {
+        for (size_t i = 0; i < part.positions.size(); ++i) {
+            StoreDocument(documents[part.positions[i]].id, std::move(part.documents[i]));
+        }
+    }
+    OnDocumentsChanged();
+}
+
+bool SearchServer::IsStopWord(std::string_view word) const {
+    return stop_words_.count(word) > 0;
+}
+
+void SearchServer::SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const {
+    if (!SplitIntoValidWords(text, words)) {
+        throw std::invalid_argument("  \"" + std::string(words.back()) + "\"  ");
+    }
+    words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) {
+        return IsStopWord(word);
+        }), words.end());
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -190,9 +700,6 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
     if (text[0] == '-') {
         throw std::invalid_argument("-   \"" + std::string(text) + "\"     \"-\"  ");
     }
-    if (!IsValidWord(text)) {
-        throw std::invalid_argument("   \"" + std::string(text) + "\"  ");
-    }
     return {
         text,
         is_minus,
@@ -202,38 +709,125 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
 
 SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const {
     Query query;
-    for (const std::string_view word : SplitIntoWords(text)) {
-        const QueryWord query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query.minus_words.insert(query_word.data);
-            }
-            else {
-                query.plus_words.insert(query_word.data);
+    std::vector<std::string_view> words;
+    ParseQuery(text, words, query);
+    return query;
+}
+
+void SearchServer::ParseQuery(const std::string_view text, std::vector<std::string_view>& words, Query& query) const {
+    query.plus_terms.clear();
+    query.minus_terms.clear();
+    const bool words_valid = SplitIntoValidWords(text, words);
+    for (size_t i = 0; i < words.size(); ++i) {
+        const QueryWord query_word = ParseQueryWord(words[i]);
+        // Errors in the form of the word go first, as they did when each word was checked separately
+        if (!words_valid && i + 1 == words.size()) {
+            throw std::invalid_argument("   \"" + std::string(query_word.data) + "\"  ");
+        }
+        if (query_word.is_stop) {
+            continue;
+        }
+        // Words missing from the index can neither add relevance nor exclude documents,
+        // as well as words left only in removed documents
+        const std::optional<TermId> term_id = index_.FindTermId(query_word.data);
+        if (!term_id || index_.GetTerm(*term_id).GetDocumentCount() == 0) {
+            continue;
+        }
+        if (query_word.is_minus) {
+            query.minus_terms.push_back(*term_id);
+        }
+        else {
+            query.plus_terms.push_back(*term_id);
+        }
+    }
+    for (std::vector<TermId>* terms : { &query.plus_terms, &query.minus_terms }) {
+        std::sort(terms->begin(), terms->end());
+        terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
+    }
+}
+
+void SearchServer::OnDocumentsChanged() {
+    log_document_count_ = log(GetDocumentCount() * 1.0);
+    generation_ = TakeGeneration();
+}
+
+uint64_t SearchServer::TakeGeneration() {
+    static std::atomic<uint64_t> next_generation{ 0 };
+    return next_generation++;
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(const InvertedIndex::Term& term) const {
+    return log_document_count_ - term.log_document_freq;
+}
+
+std::vector<int> SearchServer::SplitDocumentIds(const std::vector<QueryPostings>& segment_postings, size_t range_count) {
+    PostingView longest;
+    for (const QueryPostings& query_postings : segment_postings) {
+        for (const MaxScoreEvaluator::PlusTerm& term : query_postings.plus) {
+            if (term.postings.size() > longest.size()) {
+                longest = term.postings;
             }
         }
     }
-    return query;
+    std::vector<int> first_ids = { 0 };
+    if (longest.empty()) {
+        return first_ids;
+    }
+    for (size_t range = 1; range < range_count; ++range) {
+        const int first_id = longest.GetApproximateDocumentId(range * longest.size() / range_count);
+        if (first_id > first_ids.back()) {
+            first_ids.push_back(first_id);
+        }
+    }
+    return first_ids;
 }
 
-SearchServer::QueryPar SearchServer::ParseQueryPar(const std::string_view text) const {
-    QueryPar query_par;
-    for (const std::string_view word : SplitIntoWords(text)) {
-        const QueryWord query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query_par.minus_words.push_back(query_word.data);
+void SearchServer::FindQueryPostings(const Query& query, std::vector<QueryPostings>& segment_postings) const {
+    segment_postings.resize(index_.GetSegmentCount());
+    for (size_t segment = 0; segment < segment_postings.size(); ++segment) {
+        QueryPostings& query_postings = segment_postings[segment];
+        query_postings.plus.clear();
+        query_postings.minus.clear();
+        // Every segment is scored with the IDF of the whole index
+        for (const TermId term_id : query.plus_terms) {
+            const InvertedIndex::Term& term = index_.GetTerm(term_id);
+            const PostingView postings = index_.GetSegmentPostings(term, segment);
+            if (!postings.empty()) {
+                const double inverse_document_freq = ComputeWordInverseDocumentFreq(term);
+                query_postings.plus.push_back({ postings, inverse_document_freq, term.max_term_freq * inverse_document_freq });
             }
-            else {
-                if (std::find(query_par.plus_words.begin(), query_par.plus_words.end(), query_word.data) == query_par.plus_words.end()) {
-                    query_par.plus_words.push_back(query_word.data);
-                }
+        }
+        if (query_postings.plus.empty()) {
+            continue;
+        }
+        for (const TermId term_id : query.minus_terms) {
+            const PostingView postings = index_.GetSegmentPostings(index_.GetTerm(term_id), segment);
+            if (!postings.empty()) {
+                query_postings.minus.push_back(postings);
             }
         }
     }
-    return query_par;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+void SearchServer::ResolveQuery(const std::string_view raw_query, CompiledQuery& query) const {
+    std::vector<std::string_view> words;
+    ParseQuery(raw_query, words, query.query_);
+    FindQueryPostings(query.query_, query.segment_postings_);
+    query.text_ = raw_query;
+    query.server_ = this;
+    query.generation_ = generation_;
+    query.purge_count_ = purge_count_;
+}
+
+const SearchServer::CompiledQuery& SearchServer::GetCurrentQuery(const CompiledQuery& query, CompiledQuery& recompiled) const {
+    if (query.server_ == this && query.generation_ == generation_ && query.purge_count_ == purge_count_) {
+        return query;
+    }
+    ResolveQuery(query.text_, recompiled);
+    return recompiled;
+}
+
+SearchServer::QueryContext& SearchServer::GetThreadQueryContext() {
+    thread_local QueryContext context;
+    return context;
 }
\ No newline at end of file
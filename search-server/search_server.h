@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <array>
 #include <numeric>
 #include <algorithm>
 #include <iterator>
@@ -10,15 +11,25 @@
 #include <string_view>
 #include <utility>
 #include <future>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <exception>
+#include <type_traits>
+#include <unordered_map>
 
 #include "document.h"
+#include "document_fingerprint.h"
+#include "document_terms.h"
 #include "string_processing.h"
 #include "log_duration.h"
-#include "concurrent_map.h"
+#include "inverted_index.h"
+#include "max_score_evaluator.h"
+#include "ordinal_bitmap.h"
+#include "top_documents.h"
+#include "relevance_accumulator.h"
 
 static const int MAX_RESULT_DOCUMENT_COUNT = 5;
-static const double EQUAL_MAX_DIFFERENCE = 1e-6;
-static const size_t NUMBER_THREADS = 12;
 
 //       
 template <typename type>
@@ -47,12 +58,38 @@ public:
 
     explicit SearchServer(const std::string& stop_words_text);
 
+    // Copying stores every word anew and takes as much memory as the server itself,
+    // so a server is only copied on request, by Clone
+    SearchServer& operator=(const SearchServer&) = delete;
+    SearchServer(SearchServer&&) = default;
+    SearchServer& operator=(SearchServer&&) = default;
+
+    // Copy with a generation of its own. A loaded snapshot is shared with the copy, which keeps it mapped
+    SearchServer Clone() const;
+
     void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    struct NewDocument {
+        int id;
+        std::string_view text;
+        DocumentStatus status;
+        std::vector<int> ratings;
+    };
+
+    // Adds all documents of the batch or, if any of them is invalid, none of them.
+    // The parallel version tokenizes and indexes parts of the batch concurrently
+    void AddDocuments(const std::vector<NewDocument>& documents);
+
+    void AddDocuments(std::execution::sequenced_policy seq, const std::vector<NewDocument>& documents);
+
+    void AddDocuments(std::execution::parallel_policy par, const std::vector<NewDocument>& documents);
+
     template <typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status_input) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status_input,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status_input) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status_input,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query) const;
@@ -60,47 +97,317 @@ public:
     std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
 
     template <typename ExecutionPolicy, typename Filter>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query, Filter filter_function) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query, Filter filter_function,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename Filter>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, Filter filter_function,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Buffers of a query kept for the next one: the words, the postings, the evaluation state and
+    // the results. Queries run with a warmed up context make no heap allocations. A context may be
+    // used with different servers, but only by one thread at a time
+    class QueryContext;
+
+    // The results stay in the context until its next query. Sequential FindTopDocuments by status
+    // use a context of the calling thread and only allocate the returned vector
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view raw_query,
+        DocumentStatus status_input = DocumentStatus::ACTUAL, size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // A query parsed and resolved against the index once: its term ids, their IDFs and their postings
+    // in every segment. It is tied to the server and its generation. A stale query, or one compiled
+    // by another server, still gives right results, but is compiled again from its text on every use
+    class CompiledQuery;
+
+    CompiledQuery CompileQuery(const std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy policy, const CompiledQuery& query, DocumentStatus status_input,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const CompiledQuery& query, DocumentStatus status_input,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy policy, const CompiledQuery& query) const;
+
+    std::vector<Document> FindTopDocuments(const CompiledQuery& query) const;
+
+    template <typename ExecutionPolicy, typename Filter>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy policy, const CompiledQuery& query, Filter filter_function,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename Filter>
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, Filter filter_function) const;
+    std::vector<Document> FindTopDocuments(const CompiledQuery& query, Filter filter_function,
+        size_t max_document_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // FindTopDocuments(raw_query) for every query of the batch. Queries are taken in small groups.
+    // Queries with few plus words are evaluated one by one with MaxScore pruning, as FindTopDocuments does.
+    // For the longer ones each posting list is walked once per group for all of its queries that have the word
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const;
+
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(std::execution::sequenced_policy seq, const std::vector<std::string>& raw_queries) const;
+
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(std::execution::parallel_policy par, const std::vector<std::string>& raw_queries) const;
+
+    // Calls on_results(query_index, std::vector<Document>&& documents) for every query as soon as
+    // its group is scored, results are not collected. With par the calls come from several threads at once
+    template <typename ExecutionPolicy, typename Callback>
+    void FindTopDocumentsBatch(ExecutionPolicy policy, const std::vector<std::string>& raw_queries, Callback on_results) const;
 
     int GetDocumentCount() const;
 
-    std::set<int>::const_iterator begin() const;
+    // Changes whenever documents are added or removed. Generations are unique over all servers
+    // of the process, so a server that a loaded snapshot or another server is moved into
+    // doesn't repeat the generations it had before
+    uint64_t GetGeneration() const;
+
+    // The query in normalized form for result caching: the number of plus words, then the ids
+    // of the plus and the minus words present in the index, sorted and unique. Queries with
+    // equal keys find the same documents while the generation stays the same
+    std::vector<TermId> GetQueryKey(const std::string_view raw_query) const;
+
+    // Iterates over the document ids in increasing order
+    class DocumentIdIterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        DocumentIdIterator() = default;
+
+        explicit DocumentIdIterator(std::map<int, uint32_t>::const_iterator it)
+            : it_(it)
+        {
+        }
+
+        reference operator*() const {
+            return it_->first;
+        }
+
+        pointer operator->() const {
+            return &it_->first;
+        }
+
+        DocumentIdIterator& operator++() {
+            ++it_;
+            return *this;
+        }
+
+        DocumentIdIterator operator++(int) {
+            return DocumentIdIterator(it_++);
+        }
+
+        DocumentIdIterator& operator--() {
+            --it_;
+            return *this;
+        }
+
+        DocumentIdIterator operator--(int) {
+            return DocumentIdIterator(it_--);
+        }
 
-    std::set<int>::const_iterator end() const;
+        bool operator==(const DocumentIdIterator& other) const {
+            return it_ == other.it_;
+        }
+
+        bool operator!=(const DocumentIdIterator& other) const {
+            return it_ != other.it_;
+        }
+
+    private:
+        std::map<int, uint32_t>::const_iterator it_;
+    };
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    DocumentIdIterator begin() const;
 
+    DocumentIdIterator end() const;
+
+    // A view of the document's term array, empty for unknown ids
+    WordFrequencies GetWordFrequencies(int document_id) const;
+
+    // Sorted ids of the distinct words of the document
+    DocumentTermIds GetDocumentTermIds(int document_id) const;
+
+    // Fingerprint of the distinct words of the document, computed when it is added
+    DocumentFingerprint GetDocumentFingerprint(int document_id) const;
+
+    // The document disappears from results at once, its postings are purged later together
+    // with those of other removed documents, when enough of them pile up
     void RemoveDocument(int document_id);
 
     void RemoveDocument(std::execution::sequenced_policy seq, int document_id);
     
     void RemoveDocument(std::execution::parallel_policy par, int document_id);
 
+    // Removes the documents of the batch as one change, absent ids are skipped. Postings are purged
+    // at most once for the whole batch, the parallel version purges them concurrently
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    void RemoveDocuments(std::execution::sequenced_policy seq, const std::vector<int>& document_ids);
+
+    void RemoveDocuments(std::execution::parallel_policy par, const std::vector<int>& document_ids);
+
+    // Purges the postings of all removed documents now, for example when the server is idle.
+    // The parallel version purges the posting lists of different words concurrently
+    void PurgeRemovedDocuments();
+
+    void PurgeRemovedDocuments(std::execution::sequenced_policy seq);
+
+    void PurgeRemovedDocuments(std::execution::parallel_policy par);
+
+    // Writes the stop words, the index and the document metadata into a versioned binary file
+    void SaveSnapshot(const std::string& path) const;
+
+    // Maps the file into memory and serves posting lists and words right from it,
+    // only the document metadata is rebuilt. Changed terms are copied out of the file
+    static SearchServer LoadSnapshot(const std::string& path);
+
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy seq, const std::string_view raw_query, int document_id) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy par, const std::string_view raw_query, int document_id) const;
 
+    // MatchDocument for every id of the batch, the query is parsed once. Results go in the order
+    // of the ids, an unknown id throws std::out_of_range before anything is matched.
+    // The parallel version matches different documents concurrently
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(const std::string_view raw_query,
+        const std::vector<int>& document_ids) const;
+
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(std::execution::sequenced_policy seq,
+        const std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(std::execution::parallel_policy par,
+        const std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const CompiledQuery& query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy seq, const CompiledQuery& query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy par, const CompiledQuery& query, int document_id) const;
+
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(const CompiledQuery& query,
+        const std::vector<int>& document_ids) const;
+
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(std::execution::sequenced_policy seq,
+        const CompiledQuery& query, const std::vector<int>& document_ids) const;
+
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(std::execution::parallel_policy par,
+        const CompiledQuery& query, const std::vector<int>& document_ids) const;
+
 private:
+    // Postings of removed documents are purged once there are this many of them
+    // and they make up a sixteenth of the live documents
+    inline static constexpr size_t MIN_PURGE_BATCH_SIZE = 256;
+
+    // Batch queries with at most this many plus words are pruned well enough to be evaluated on their own,
+    // longer ones are scored faster term-at-a-time with the walks shared in their group
+    inline static constexpr size_t MAX_PRUNED_BATCH_QUERY_TERMS = 6;
+
+    SearchServer() = default;
+
+    SearchServer(const SearchServer&) = default;
+
+    // A document on its way into the per-ordinal arrays. The text itself is not kept,
+    // words live in the index dictionary
     struct DocumentData {
-        std::string text_doc;
         int rating;
         DocumentStatus status;
+        uint32_t ordinal;
+        std::vector<DocumentTerm> terms;
     };
 
-    std::map <int, std::map<std::string_view, double>> document_to_word_freqs_;
     std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
+    InvertedIndex index_;
+    // Compact numbering of live documents, freed ordinals are reused. The metadata is kept in arrays
+    // indexed by ordinal, so scoring reads it with one indexed load per document
+    std::map<int, uint32_t> document_ordinals_;
+    std::vector<int> ordinal_to_document_id_;
+    std::vector<int> ratings_;
+    std::vector<DocumentStatus> statuses_;
+    // 1 / word count of a document; postings keep word counts and the term frequency is count * this
+    std::vector<double> inverse_word_counts_;
+    // Distinct words of a document sorted by term id, with their counts
+    std::vector<std::vector<DocumentTerm>> document_terms_;
+    std::vector<DocumentFingerprint> fingerprints_;
+    // Ordinals of removed documents come here only after their postings are purged
+    std::vector<uint32_t> free_ordinals_;
+    // Ordinals of the documents that are not removed
+    OrdinalBitmap live_ordinals_;
+    // Removed documents whose postings are still in the index, by id
+    std::unordered_map<int, uint32_t> removed_documents_;
+    // Ordinals of the documents with each status, a status filter is a bit test
+    std::array<OrdinalBitmap, DOCUMENT_STATUS_COUNT> status_ordinals_;
+    // log(GetDocumentCount()), together with the per-term log(df) it makes IDF a subtraction
+    double log_document_count_ = 0.0;
+    uint64_t generation_ = TakeGeneration();
+    // Changes when a purge rewrites posting lists, which leaves the generation as it is
+    uint64_t purge_count_ = 0;
+
+    uint32_t AcquireOrdinal(int document_id, double inverse_word_count);
+
+    // Fills the per-ordinal arrays of an acquired ordinal
+    void StoreDocument(int document_id, DocumentData&& document);
+
+    double ComputeTermFreq(const Posting& posting) const;
+
+    const OrdinalBitmap& GetStatusOrdinals(DocumentStatus status) const;
+
+    struct DocumentRecord {
+        int id;
+        int rating;
+        DocumentStatus status;
+        uint32_t ordinal;
+        uint32_t term_count;
+    };
+
+    // Documents of a batch part in increasing id order, with the part's own vocabulary and posting lists
+    struct BatchPart {
+        std::vector<size_t> positions;
+        std::vector<std::string_view> words;
+        std::vector<TermId> term_ids;
+        // (index in words, occurrence count) for every document, sorted by the index
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> document_words;
+        std::vector<double> inverse_word_counts;
+        std::vector<uint32_t> ordinals;
+        std::vector<DocumentData> documents;
+        std::vector<std::vector<Posting>> postings;
+        std::exception_ptr error;
+    };
+
+    template <typename ExecutionPolicy>
+    void InsertDocuments(ExecutionPolicy policy, const std::vector<NewDocument>& documents);
+
+    // Checks the ids and splits the batch into parts of consecutive ids
+    std::vector<BatchPart> SplitDocumentBatch(const std::vector<NewDocument>& documents, size_t part_count) const;
+
+    void TokenizeBatchPart(const std::vector<NewDocument>& documents, BatchPart& part) const;
+
+    // The only step that changes the dictionary, so it goes serially
+    void InternBatchWords(const std::vector<NewDocument>& documents, std::vector<BatchPart>& parts);
+
+    void IndexBatchPart(const std::vector<NewDocument>& documents, BatchPart& part) const;
+
+    static std::vector<std::pair<TermId, std::vector<std::vector<Posting>>>> CollectBatchPostings(std::vector<BatchPart>& parts);
+
+    void StoreBatchDocuments(const std::vector<NewDocument>& documents, std::vector<BatchPart>& parts);
+
+    // Hides the document from results and keeps it for the next purge. False if there is no such document
+    bool MarkDocumentRemoved(int document_id);
+
+    template <typename ExecutionPolicy>
+    void EraseDocuments(ExecutionPolicy policy, const int* first, const int* last);
+
+    template <typename ExecutionPolicy>
+    void PurgeRemoved(ExecutionPolicy policy);
 
     bool IsStopWord(std::string_view word) const;
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    // Fills the buffer with the words of the text that are not stop words
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
@@ -110,30 +417,116 @@ private:
         bool is_stop;
     };
 
+    // Control characters are not checked here, the tokenizer finds them
     QueryWord ParseQueryWord(std::string_view text) const;
 
+    // Sorted unique ids of the query words that are present in the index
     struct Query {
-        std::set<std::string_view> plus_words;
-        std::set<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
     };
 
-    struct QueryPar {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+    Query ParseQuery(const std::string_view text) const;
+
+    // Fills query from the text, words is the buffer for its tokens
+    void ParseQuery(const std::string_view text, std::vector<std::string_view>& words, Query& query) const;
+
+    // Intersects the sorted query terms with the sorted terms of the document
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchQuery(const Query& query, uint32_t ordinal) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchQueryBatch(ExecutionPolicy policy, const Query& query,
+        const std::vector<int>& document_ids) const;
+
+    // Updates what depends on the set of documents: log(document count) and the generation
+    void OnDocumentsChanged();
+
+    static uint64_t TakeGeneration();
+
+    double ComputeWordInverseDocumentFreq(const InvertedIndex::Term& term) const;
+
+    struct QueryPostings {
+        std::vector<MaxScoreEvaluator::PlusTerm> plus;
+        std::vector<PostingView> minus;
     };
 
-    Query ParseQuery(const std::string_view text) const;
+    // Postings of the query in every index segment. Segments without postings of the plus words
+    // are left empty rather than removed, so the buffers of all elements are reused
+    void FindQueryPostings(const Query& query, std::vector<QueryPostings>& segment_postings) const;
+
+    // Lower bounds of document id ranges with roughly equal amounts of postings
+    static std::vector<int> SplitDocumentIds(const std::vector<QueryPostings>& segment_postings, size_t range_count);
 
-    QueryPar ParseQueryPar(const std::string_view text) const;
+    // Segments are evaluated one after another into the same top documents, so later ones
+    // are pruned by the relevances found in earlier ones. Documents outside allowed_ordinals
+    // are skipped before the filter is called
+    template <typename Filter>
+    void FindTopDocumentsInRange(const std::vector<QueryPostings>& segment_postings, int first_id, int64_t last_id,
+        Filter& filter_function, const OrdinalBitmap* allowed_ordinals, MaxScoreEvaluator& evaluator, TopDocuments& top_documents) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    // Leaves the results in the context
+    template <typename ExecutionPolicy, typename Filter>
+    void FindAllDocuments(const ExecutionPolicy policy, QueryContext& context, const std::string_view raw_query, Filter& filter_function,
+        size_t max_document_count, const OrdinalBitmap* allowed_ordinals) const;
 
+    // Scores resolved postings, the context gives the buffers and keeps the results
     template <typename ExecutionPolicy, typename Filter>
-    std::vector<Document> FindAllDocuments(const ExecutionPolicy policy, const QueryPar& query, Filter filter_function) const;
+    void ScoreQueryPostings(const ExecutionPolicy policy, QueryContext& context, const std::vector<QueryPostings>& segment_postings,
+        Filter& filter_function, size_t max_document_count, const OrdinalBitmap* allowed_ordinals) const;
 
-    template <typename Filter>
-    std::vector<Document> FindAllDocuments(const Query& query, Filter filter_function) const;
+    void ResolveQuery(const std::string_view raw_query, CompiledQuery& query) const;
+
+    // The query itself if it was compiled by this server in its current state, otherwise
+    // recompiled filled from the query's text
+    const CompiledQuery& GetCurrentQuery(const CompiledQuery& query, CompiledQuery& recompiled) const;
+
+    // Nothing inside a sequential query by status can start another query on the same thread,
+    // so such queries share a context per thread
+    static QueryContext& GetThreadQueryContext();
+
+    // Parsed queries in scoring order, cut into groups that are scored together
+    struct QueryBatch {
+        std::vector<Query> queries;
+        std::vector<size_t> order;
+        std::vector<size_t> group_starts;
+    };
+
+    // Parsing goes first and serially, so an invalid query throws before any scoring
+    QueryBatch ParseQueryBatch(const std::vector<std::string>& raw_queries) const;
+
+    // Top documents of the queries at the given positions
+    std::vector<TopDocuments> ScoreQueryGroup(const std::vector<Query>& queries, const size_t* first, const size_t* last) const;
+};
+
+class SearchServer::QueryContext {
+private:
+    friend class SearchServer;
+
+    std::vector<std::string_view> words_;
+    Query query_;
+    std::vector<QueryPostings> segment_postings_;
+    MaxScoreEvaluator evaluator_;
+    TopDocuments top_documents_ = TopDocuments(0);
+    std::vector<Document> documents_;
+};
+
+class SearchServer::CompiledQuery {
+public:
+    const std::string& GetText() const {
+        return text_;
+    }
+
+private:
+    friend class SearchServer;
+
+    std::string text_;
+    const SearchServer* server_ = nullptr;
+    uint64_t generation_ = 0;
+    uint64_t purge_count_ = 0;
+    Query query_;
+    // Plus terms keep increasing id order, so relevances are summed as for the raw query.
+    // The evaluator orders them by relevance bound on its own
+    std::vector<QueryPostings> segment_postings_;
 };
 
 template <typename StringContainer>
@@ -143,133 +536,239 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status_input) const {
-    return FindTopDocuments(policy, raw_query, [status_input](int id, DocumentStatus status, int rating) {
-        return status == status_input;
-        });
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status_input,
+    size_t max_document_count) const {
+    if (!std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>) {
+        return FindTopDocuments(GetThreadQueryContext(), raw_query, status_input, max_document_count);
+    }
+    // The status is checked in the bitmap, the filter has nothing left to do
+    auto filter_function = [](int id, DocumentStatus status, int rating) {
+        return true;
+    };
+    QueryContext context;
+    FindAllDocuments(policy, context, raw_query, filter_function, max_document_count, &GetStatusOrdinals(status_input));
+    return std::move(context.documents_);
 }
 
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query) const {
-    return FindTopDocuments(policy, raw_query, [](int id, DocumentStatus status, int rating) {
-        return status == DocumentStatus::ACTUAL;
-        });
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
 template <typename ExecutionPolicy, typename Filter>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query, Filter filter_function) const {
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy policy, const std::string_view raw_query, Filter filter_function,
+    size_t max_document_count) const {
     if (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
-        return FindTopDocuments(raw_query, filter_function);
+        return FindTopDocuments(raw_query, filter_function, max_document_count);
     }
-    const QueryPar query_par = ParseQueryPar(raw_query);
-    //std::unique(std::execution::par, query_par.plus_words.begin(), query_par.plus_words.end());
-    auto matched_documents = FindAllDocuments(std::execution::par, query_par, filter_function);
-
-    //LOG_DURATION("Sorting in FindTopDocuments");
-    std::sort(std::execution::par, matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EQUAL_MAX_DIFFERENCE) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    QueryContext context;
+    FindAllDocuments(std::execution::par, context, raw_query, filter_function, max_document_count, &live_ordinals_);
+    return std::move(context.documents_);
+}
+
+template <typename Filter>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, Filter filter_function,
+    size_t max_document_count) const {
+    // The filter may run queries of its own, so the context isn't shared
+    QueryContext context;
+    FindAllDocuments(std::execution::seq, context, raw_query, filter_function, max_document_count, &live_ordinals_);
+    return std::move(context.documents_);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy policy, const CompiledQuery& query, DocumentStatus status_input,
+    size_t max_document_count) const {
+    auto filter_function = [](int id, DocumentStatus status, int rating) {
+        return true;
+    };
+    CompiledQuery recompiled;
+    const CompiledQuery& current = GetCurrentQuery(query, recompiled);
+    if (!std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>) {
+        QueryContext& context = GetThreadQueryContext();
+        ScoreQueryPostings(std::execution::seq, context, current.segment_postings_, filter_function, max_document_count,
+            &GetStatusOrdinals(status_input));
+        return context.documents_;
     }
-    return matched_documents;
+    QueryContext context;
+    ScoreQueryPostings(policy, context, current.segment_postings_, filter_function, max_document_count, &GetStatusOrdinals(status_input));
+    return std::move(context.documents_);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy policy, const CompiledQuery& query) const {
+    return FindTopDocuments(policy, query, DocumentStatus::ACTUAL);
+}
+
+template <typename ExecutionPolicy, typename Filter>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy policy, const CompiledQuery& query, Filter filter_function,
+    size_t max_document_count) const {
+    CompiledQuery recompiled;
+    const CompiledQuery& current = GetCurrentQuery(query, recompiled);
+    // The filter may run queries of its own, so the context isn't shared
+    QueryContext context;
+    ScoreQueryPostings(policy, context, current.segment_postings_, filter_function, max_document_count, &live_ordinals_);
+    return std::move(context.documents_);
 }
 
 template <typename Filter>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, Filter filter_function) const {
-    const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, filter_function);
-
-    //LOG_DURATION("Sorting in FindTopDocuments");
-    sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EQUAL_MAX_DIFFERENCE) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
+std::vector<Document> SearchServer::FindTopDocuments(const CompiledQuery& query, Filter filter_function,
+    size_t max_document_count) const {
+    return FindTopDocuments(std::execution::seq, query, filter_function, max_document_count);
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::InsertDocuments(ExecutionPolicy policy, const std::vector<NewDocument>& documents) {
+    const size_t part_count = std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>
+        ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    std::vector<BatchPart> parts = SplitDocumentBatch(documents, part_count);
+    // A posting list can't hold two postings of one id
+    if (std::any_of(documents.begin(), documents.end(), [this](const NewDocument& document) {
+        return removed_documents_.count(document.id) > 0;
+        })) {
+        PurgeRemoved(policy);
+    }
+    std::for_each(policy, parts.begin(), parts.end(), [this, &documents](BatchPart& part) {
+        TokenizeBatchPart(documents, part);
         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    for (const BatchPart& part : parts) {
+        if (part.error) {
+            std::rethrow_exception(part.error);
+        }
     }
-    return matched_documents;
+    InternBatchWords(documents, parts);
+    std::for_each(policy, parts.begin(), parts.end(), [this, &documents](BatchPart& part) {
+        IndexBatchPart(documents, part);
+        });
+    auto term_postings = CollectBatchPostings(parts);
+    index_.MergePostings(policy, term_postings, [this](const Posting& posting) {
+        return ComputeTermFreq(posting);
+        });
+    StoreBatchDocuments(documents, parts);
 }
 
-template <typename ExecutionPolicy, typename Filter>
-std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy policy, const QueryPar& query_par, Filter filter_function) const {
-    ConcurrentMap<int, double> document_to_relevance(NUMBER_THREADS);
-
-    std::for_each(policy, query_par.plus_words.begin(), query_par.plus_words.end(), [&](const std::string_view word) {
-        if (word_to_document_freqs_.count(word) != 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const DocumentData& document = documents_.at(document_id);
-                if (filter_function(document_id, document.status, document.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
-            }
+template <typename ExecutionPolicy, typename Callback>
+void SearchServer::FindTopDocumentsBatch(ExecutionPolicy policy, const std::vector<std::string>& raw_queries, Callback on_results) const {
+    const QueryBatch batch = ParseQueryBatch(raw_queries);
+    std::for_each(policy, batch.group_starts.begin(), batch.group_starts.end(), [&](size_t start) {
+        const size_t* first = batch.order.data() + start;
+        const size_t* last = first + std::min(GroupRelevanceAccumulator::GROUP_SIZE, batch.order.size() - start);
+        std::vector<TopDocuments> top_documents = ScoreQueryGroup(batch.queries, first, last);
+        for (size_t slot = 0; slot < top_documents.size(); ++slot) {
+            on_results(first[slot], top_documents[slot].Extract());
         }
         });
+}
 
-    std::for_each(policy, query_par.minus_words.begin(), query_par.minus_words.end(), [&](const std::string_view word) {
-        if (word_to_document_freqs_.count(word) != 0) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.Erase(document_id);
-            }
+template <typename ExecutionPolicy>
+void SearchServer::EraseDocuments(ExecutionPolicy policy, const int* first, const int* last) {
+    bool changed = false;
+    for (; first != last; ++first) {
+        changed = MarkDocumentRemoved(*first) || changed;
+    }
+    if (!changed) {
+        return;
+    }
+    OnDocumentsChanged();
+    if (removed_documents_.size() >= std::max(MIN_PURGE_BATCH_SIZE, document_ordinals_.size() / 16)) {
+        PurgeRemoved(policy);
+    }
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::PurgeRemoved(ExecutionPolicy policy) {
+    if (removed_documents_.empty()) {
+        return;
+    }
+    // Every affected posting list is rewritten once for the whole batch
+    std::vector<TermId> term_ids;
+    for (const auto& [document_id, ordinal] : removed_documents_) {
+        for (const DocumentTerm& term : document_terms_[ordinal]) {
+            term_ids.push_back(term.term_id);
         }
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    index_.PurgePostings(policy, term_ids, [this](const Posting& posting) {
+        return !live_ordinals_.Test(posting.document_ordinal);
         });
+    for (const auto& [document_id, ordinal] : removed_documents_) {
+        std::vector<DocumentTerm>().swap(document_terms_[ordinal]);
+        free_ordinals_.push_back(ordinal);
+    }
+    removed_documents_.clear();
+    ++purge_count_;
+    // Documents refer to words by term id, so moved words need no fixing up
+    index_.CompactWords();
+}
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back({
-            document_id,
-            relevance,
-            documents_.at(document_id).rating
-            });
+template <typename ExecutionPolicy>
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchQueryBatch(ExecutionPolicy policy, const Query& query,
+    const std::vector<int>& document_ids) const {
+    // Ids are checked up front, an exception can't leave a parallel algorithm
+    std::vector<uint32_t> ordinals;
+    ordinals.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        ordinals.push_back(document_ordinals_.at(document_id));
     }
-    return matched_documents;
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> results(ordinals.size());
+    std::transform(policy, ordinals.begin(), ordinals.end(), results.begin(), [this, &query](uint32_t ordinal) {
+        return MatchQuery(query, ordinal);
+        });
+    return results;
 }
 
 template <typename Filter>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Filter filter_function) const {
-    //LOG_DURATION("Function FindAllDocuments");
-    std::map<int, double> document_to_relevance;
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+void SearchServer::FindTopDocumentsInRange(const std::vector<QueryPostings>& segment_postings, int first_id, int64_t last_id,
+    Filter& filter_function, const OrdinalBitmap* allowed_ordinals, MaxScoreEvaluator& evaluator, TopDocuments& top_documents) const {
+    for (const QueryPostings& query_postings : segment_postings) {
+        if (query_postings.plus.empty()) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const DocumentData& document = documents_.at(document_id);
-            if (filter_function(document_id, document.status, document.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        evaluator.Start(query_postings.plus, query_postings.minus, inverse_word_counts_, allowed_ordinals, first_id, last_id);
+        MaxScoreEvaluator::Match match;
+        // Relevances closer than EQUAL_MAX_DIFFERENCE are ranked by rating, so documents within twice
+        // of it below the worst kept one are still evaluated
+        while (evaluator.Next(top_documents.GetMinRelevance() - 2 * EQUAL_MAX_DIFFERENCE, match)) {
+            const int rating = ratings_[match.document_ordinal];
+            if (filter_function(match.document_id, statuses_[match.document_ordinal], rating)) {
+                top_documents.Add({ match.document_id, match.relevance, rating });
             }
         }
     }
+}
 
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
-        }
+template <typename ExecutionPolicy, typename Filter>
+void SearchServer::FindAllDocuments(const ExecutionPolicy policy, QueryContext& context, const std::string_view raw_query, Filter& filter_function,
+    size_t max_document_count, const OrdinalBitmap* allowed_ordinals) const {
+    //LOG_DURATION("Function FindAllDocuments");
+    ParseQuery(raw_query, context.words_, context.query_);
+    FindQueryPostings(context.query_, context.segment_postings_);
+    ScoreQueryPostings(policy, context, context.segment_postings_, filter_function, max_document_count, allowed_ordinals);
+}
+
+template <typename ExecutionPolicy, typename Filter>
+void SearchServer::ScoreQueryPostings(const ExecutionPolicy policy, QueryContext& context, const std::vector<QueryPostings>& segment_postings,
+    Filter& filter_function, size_t max_document_count, const OrdinalBitmap* allowed_ordinals) const {
+    if (!std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>) {
+        context.top_documents_.Reset(max_document_count);
+        FindTopDocumentsInRange(segment_postings, 0, std::numeric_limits<int64_t>::max(), filter_function, allowed_ordinals,
+            context.evaluator_, context.top_documents_);
+        context.top_documents_.Extract(context.documents_);
+        return;
     }
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({
-            document_id,
-            relevance,
-            documents_.at(document_id).rating
-            });
+    // Every thread scores its own id range with its own evaluator and heap, no locking is needed
+    const std::vector<int> first_ids = SplitDocumentIds(segment_postings, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<TopDocuments> range_tops(first_ids.size(), TopDocuments(max_document_count));
+    std::vector<size_t> ranges(first_ids.size());
+    std::iota(ranges.begin(), ranges.end(), 0);
+    std::for_each(policy, ranges.begin(), ranges.end(), [&](size_t range) {
+        const int64_t last_id = range + 1 < first_ids.size() ? first_ids[range + 1] : std::numeric_limits<int64_t>::max();
+        MaxScoreEvaluator evaluator;
+        FindTopDocumentsInRange(segment_postings, first_ids[range], last_id, filter_function, allowed_ordinals, evaluator, range_tops[range]);
+        });
+    for (size_t range = 1; range < range_tops.size(); ++range) {
+        range_tops[0].Merge(range_tops[range]);
     }
-    return matched_documents;
+    range_tops[0].Extract(context.documents_);
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("      " + path);
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("      " + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("      " + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    void* const data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("        " + path);
+    }
+    data_ = static_cast<const char*>(data);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    munmap(const_cast<char*>(data_), size_);
+#endif
+}
+
+const char* MappedFile::GetData() const {
+    return data_;
+}
+
+size_t MappedFile::GetSize() const {
+    return size_;
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& path)
+    : path_(path)
+    , temporary_path_(path + ".tmp")
+    , output_(temporary_path_, std::ios::binary | std::ios::trunc)
+{
+    if (!output_) {
+        throw std::runtime_error("      " + path);
+    }
+    WriteBytes(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    const uint64_t version = SNAPSHOT_VERSION;
+    WriteBytes(&version, sizeof(version));
+}
+
+void SnapshotWriter::WriteStrings(const std::vector<std::string_view>& strings) {
+    std::vector<uint64_t> offsets;
+    offsets.reserve(strings.size() + 1);
+    offsets.push_back(0);
+    std::string text;
+    for (const std::string_view str : strings) {
+        text += str;
+        offsets.push_back(text.size());
+    }
+    WriteArray(offsets);
+    WriteArray(text.data(), text.size());
+}
+
+void SnapshotWriter::Finish() {
+    output_.close();
+    if (!output_) {
+        std::remove(temporary_path_.c_str());
+        throw std::runtime_error("     " + path_);
+    }
+#ifdef _WIN32
+    // rename doesn't replace existing files here, the old snapshot isn't held open by a loaded server
+    std::remove(path_.c_str());
+#endif
+    // A mapping of the replaced file keeps its data until it is unmapped
+    if (std::rename(temporary_path_.c_str(), path_.c_str()) != 0) {
+        std::remove(temporary_path_.c_str());
+        throw std::runtime_error("     " + path_);
+    }
+}
+
+void SnapshotWriter::WriteBytes(const void* data, size_t size) {
+    output_.write(static_cast<const char*>(data), size);
+    offset_ += size;
+}
+
+void SnapshotWriter::Align() {
+    static const char padding[8] = {};
+    WriteBytes(padding, (8 - offset_ % 8) % 8);
+}
+
+SnapshotReader::SnapshotReader(const char* data, size_t size)
+    : data_(data)
+    , size_(size)
+{
+    if (size_ < sizeof(SNAPSHOT_MAGIC) || std::memcmp(ReadBytes(sizeof(SNAPSHOT_MAGIC)), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        throw std::runtime_error("    ");
+    }
+    uint64_t version;
+    std::memcpy(&version, ReadBytes(sizeof(version)), sizeof(version));
+    if (version != SNAPSHOT_VERSION) {
+        throw std::runtime_error("    " + std::to_string(version));
+    }
+}
+
+std::vector<std::string_view> SnapshotReader::ReadStrings() {
+    const SnapshotArray<uint64_t> offsets = ReadArray<uint64_t>();
+    const SnapshotArray<char> text = ReadArray<char>();
+    if (offsets.size == 0) {
+        throw std::runtime_error("  ");
+    }
+    std::vector<std::string_view> strings;
+    strings.reserve(offsets.size - 1);
+    for (size_t i = 0; i + 1 < offsets.size; ++i) {
+        if (offsets.data[i] > offsets.data[i + 1] || offsets.data[i + 1] > text.size) {
+            throw std::runtime_error("  ");
+        }
+        strings.emplace_back(text.data + offsets.data[i], offsets.data[i + 1] - offsets.data[i]);
+    }
+    return strings;
+}
+
+const char* SnapshotReader::ReadBytes(size_t size) {
+    if (size > size_ - offset_) {
+        throw std::runtime_error("  ");
+    }
+    const char* const bytes = data_ + offset_;
+    offset_ += size;
+    return bytes;
+}
+
+void SnapshotReader::Align() {
+    offset_ = std::min(size_, (offset_ + 7) / 8 * 8);
+}
\ No newline at end of file
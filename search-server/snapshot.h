@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Binary index snapshot: a header followed by arrays. Every array is prefixed with its
+// element count and element size and starts at an 8 byte boundary, so it can be used
+// in place once mapped.
+// Numbers are stored in the byte order of the machine that wrote the file.
+inline constexpr char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P' };
+inline constexpr uint32_t SNAPSHOT_VERSION = 4;
+
+// The whole file mapped read-only into memory, or read into a buffer where mmap is not available
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const char* GetData() const;
+
+    size_t GetSize() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    std::vector<char> buffer_;
+#endif
+};
+
+template <typename T>
+struct SnapshotArray {
+    const T* data = nullptr;
+    size_t size = 0;
+
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+};
+
+class SnapshotWriter {
+public:
+    // Starts the file with the magic and the format version. The data goes into a temporary
+    // file first, so a snapshot mapped by a running server is never overwritten in place
+    explicit SnapshotWriter(const std::string& path);
+
+    template <typename T>
+    void WriteArray(const T* data, size_t count);
+
+    template <typename T>
+    void WriteArray(const std::vector<T>& values);
+
+    void WriteStrings(const std::vector<std::string_view>& strings);
+
+    // Throws if anything failed to be written, otherwise puts the file in place
+    void Finish();
+
+private:
+    std::string path_;
+    std::string temporary_path_;
+    std::ofstream output_;
+    uint64_t offset_ = 0;
+
+    void WriteBytes(const void* data, size_t size);
+
+    void Align();
+};
+
+class SnapshotReader {
+public:
+    // Checks the magic and the format version
+    SnapshotReader(const char* data, size_t size);
+
+    template <typename T>
+    SnapshotArray<T> ReadArray();
+
+    // Views of the strings point into the snapshot data
+    std::vector<std::string_view> ReadStrings();
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+
+    const char* ReadBytes(size_t size);
+
+    void Align();
+};
+
+template <typename T>
+void SnapshotWriter::WriteArray(const T* data, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= 8);
+    const uint64_t header[2] = { count, sizeof(T) };
+    WriteBytes(header, sizeof(header));
+    WriteBytes(data, count * sizeof(T));
+    Align();
+}
+
+template <typename T>
+void SnapshotWriter::WriteArray(const std::vector<T>& values) {
+    WriteArray(values.data(), values.size());
+}
+
+template <typename T>
+SnapshotArray<T> SnapshotReader::ReadArray() {
+    static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= 8);
+    uint64_t header[2];
+    std::memcpy(header, ReadBytes(sizeof(header)), sizeof(header));
+    const uint64_t size = header[0];
+    if (header[1] != sizeof(T) || size > (size_ - offset_) / sizeof(T)) {
+        throw std::runtime_error("  ");
+    }
+    const T* data = reinterpret_cast<const T*>(ReadBytes(size * sizeof(T)));
+    Align();
+    return { data, static_cast<size_t>(size) };
+}
\ No newline at end of file
@@ -1,21 +1,164 @@
 #include "string_processing.h"
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 
-std::vector<std::string_view> SplitIntoWords(std::string_view text) {
-    std::vector<std::string_view> words;
-    text.remove_prefix(std::min(text.size(), static_cast<size_t>(text.find_first_not_of(" "))));
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEARCH_SERVER_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled for a target chosen per function, which only GCC and Clang allow
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_SERVER_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// The text is scanned in chunks of 64 bytes, each described by bit masks with one bit per byte
+constexpr size_t CHUNK_SIZE = 64;
+
+struct ChunkMasks {
+    uint64_t spaces;
+    // Bytes 0-31, which words may not contain
+    uint64_t controls;
+};
+
+using FindSeparatorsFunction = ChunkMasks(*)(const char* chunk);
+
+#if !defined(SEARCH_SERVER_SSE2)
+ChunkMasks FindSeparatorsScalar(const char* chunk) {
+    ChunkMasks masks{ 0, 0 };
+    for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+        const unsigned char c = static_cast<unsigned char>(chunk[i]);
+        masks.spaces |= static_cast<uint64_t>(c == ' ') << i;
+        masks.controls |= static_cast<uint64_t>(c < ' ') << i;
+    }
+    return masks;
+}
+#endif
+
+#ifdef SEARCH_SERVER_SSE2
+ChunkMasks FindSeparatorsSse2(const char* chunk) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i last_control = _mm_set1_epi8(' ' - 1);
+    ChunkMasks masks{ 0, 0 };
+    for (size_t i = 0; i < CHUNK_SIZE; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk + i));
+        // Bytes are signed, control characters are the ones that an unsigned min with 31 leaves unchanged
+        const __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(bytes, last_control), bytes);
+        masks.spaces |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, space)))) << i;
+        masks.controls |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(controls))) << i;
+    }
+    return masks;
+}
+#endif
 
-    while (!text.empty()) {
-        size_t space = text.find(' ');
-        size_t amount = (space == text.npos ? text.size() : space);
-        auto str_plus = text.substr(0, amount);
-        words.push_back(str_plus);
+#ifdef SEARCH_SERVER_AVX2
+__attribute__((target("avx2"))) ChunkMasks FindSeparatorsAvx2(const char* chunk) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i last_control = _mm256_set1_epi8(' ' - 1);
+    ChunkMasks masks{ 0, 0 };
+    for (size_t i = 0; i < CHUNK_SIZE; i += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(chunk + i));
+        const __m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, last_control), bytes);
+        masks.spaces |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, space)))) << i;
+        masks.controls |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(controls))) << i;
+    }
+    return masks;
+}
+#endif
+
+FindSeparatorsFunction SelectFindSeparators() {
+#ifdef SEARCH_SERVER_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return FindSeparatorsAvx2;
+    }
+#endif
+#ifdef SEARCH_SERVER_SSE2
+    return FindSeparatorsSse2;
+#else
+    return FindSeparatorsScalar;
+#endif
+}
+
+unsigned CountTrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(value))) {
+        return index;
+    }
+    _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+    return index + 32;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+} // namespace
 
-        text.remove_prefix(std::min(text.size(), amount));
-        text.remove_prefix(std::min(text.size(), static_cast<size_t>(text.find_first_not_of(" "))));
+bool SplitIntoValidWords(std::string_view text, std::vector<std::string_view>& words) {
+    static const FindSeparatorsFunction find_separators = SelectFindSeparators();
+    words.clear();
+    size_t word_start = text.npos;
+    // Bit positions where a space follows a non-space or the other way round alternate
+    // between word starts and word ends
+    const auto add_boundaries = [&](size_t chunk_start, uint64_t boundaries) {
+        for (; boundaries != 0; boundaries &= boundaries - 1) {
+            const size_t position = chunk_start + CountTrailingZeros(boundaries);
+            if (word_start == text.npos) {
+                word_start = position;
+            }
+            else {
+                words.push_back(text.substr(word_start, position - word_start));
+                word_start = text.npos;
+            }
+        }
+    };
+    uint64_t previous_space = 1;
+    char padded_chunk[CHUNK_SIZE];
+    for (size_t chunk_start = 0; chunk_start < text.size(); chunk_start += CHUNK_SIZE) {
+        const char* chunk = text.data() + chunk_start;
+        if (text.size() - chunk_start < CHUNK_SIZE) {
+            // Spaces past the end of the text end its last word
+            std::memset(padded_chunk, ' ', CHUNK_SIZE);
+            std::memcpy(padded_chunk, chunk, text.size() - chunk_start);
+            chunk = padded_chunk;
+        }
+        const ChunkMasks masks = find_separators(chunk);
+        const uint64_t boundaries = masks.spaces ^ (masks.spaces << 1 | previous_space);
+        previous_space = masks.spaces >> (CHUNK_SIZE - 1);
+        if (masks.controls != 0) {
+            // The word with the control character is the last one returned
+            const unsigned control = CountTrailingZeros(masks.controls);
+            add_boundaries(chunk_start, control + 1 == CHUNK_SIZE ? boundaries : boundaries & ((uint64_t{ 2 } << control) - 1));
+            const size_t word_end = std::min(text.find(' ', chunk_start + control), text.size());
+            words.push_back(text.substr(word_start, word_end - word_start));
+            return false;
+        }
+        add_boundaries(chunk_start, boundaries);
     }
+    if (word_start != text.npos) {
+        words.push_back(text.substr(word_start));
+    }
+    return true;
+}
 
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    std::vector<std::string_view> words;
+    std::vector<std::string_view> part;
+    // Splitting stops after a word with control characters, the rest of the text is split again
+    while (!SplitIntoValidWords(text, part)) {
+        words.insert(words.end(), part.begin(), part.end());
+        text.remove_prefix(part.back().data() + part.back().size() - text.data());
+    }
+    words.insert(words.end(), part.begin(), part.end());
     return words;
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 #include <stdexcept>
@@ -8,6 +9,10 @@ using namespace std::string_literals;
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
+// Splits the text by spaces into the caller's buffer, which is cleared first, and checks the words for
+// control characters in the same pass. Returns false if a word has them: it is the last one in words then
+bool SplitIntoValidWords(std::string_view text, std::vector<std::string_view>& words);
+
 bool IsValidWord(const std::string_view word);
 
 template <typename StringContainer>
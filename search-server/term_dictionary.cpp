@@ -0,0 +1,149 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+    : words_(other.words_)
+    , word_slabs_(other.word_slabs_)
+    , free_ids_(other.free_ids_)
+{
+    // Live words are packed into new slabs, the space released in the original isn't copied
+    ids_.reserve(other.ids_.size());
+    for (TermId term_id = 0; term_id < words_.size(); ++term_id) {
+        if (words_[term_id].empty()) {
+            continue;
+        }
+        if (word_slabs_[term_id] != EXTERNAL_SLAB) {
+            StoreWord(term_id, words_[term_id]);
+        }
+        ids_.emplace(words_[term_id], term_id);
+    }
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        *this = TermDictionary(other);
+    }
+    return *this;
+}
+
+TermId TermDictionary::Intern(std::string_view word) {
+    const auto it = ids_.find(word);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    TermId term_id;
+    if (!free_ids_.empty()) {
+        term_id = free_ids_.back();
+        free_ids_.pop_back();
+    }
+    else {
+        term_id = static_cast<TermId>(words_.size());
+        words_.emplace_back();
+        word_slabs_.emplace_back();
+    }
+    ids_.emplace(StoreWord(term_id, word), term_id);
+    return term_id;
+}
+
+std::optional<TermId> TermDictionary::Find(std::string_view word) const {
+    const auto it = ids_.find(word);
+    if (it == ids_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::string_view TermDictionary::GetWord(TermId term_id) const {
+    return words_[term_id];
+}
+
+void TermDictionary::Release(TermId term_id) {
+    const std::string_view word = words_[term_id];
+    ids_.erase(word);
+    if (word_slabs_[term_id] != EXTERNAL_SLAB) {
+        slabs_[word_slabs_[term_id]].live_bytes -= word.size();
+        live_bytes_ -= word.size();
+        released_bytes_ += word.size();
+    }
+    words_[term_id] = {};
+    free_ids_.push_back(term_id);
+}
+
+size_t TermDictionary::GetIdCount() const {
+    return words_.size();
+}
+
+void TermDictionary::LoadWords(const std::vector<std::string_view>& words) {
+    *this = TermDictionary();
+    words_ = words;
+    word_slabs_.assign(words_.size(), EXTERNAL_SLAB);
+    ids_.reserve(words_.size());
+    for (TermId term_id = 0; term_id < words_.size(); ++term_id) {
+        if (words_[term_id].empty()) {
+            free_ids_.push_back(term_id);
+        }
+        else {
+            ids_.emplace(words_[term_id], term_id);
+        }
+    }
+}
+
+std::string_view TermDictionary::StoreWord(TermId term_id, std::string_view word) {
+    if (slabs_.empty() || slabs_.back().capacity - slabs_.back().used < word.size()) {
+        // Words longer than a slab get a slab of their own
+        const size_t capacity = std::max(SLAB_SIZE, word.size());
+        slabs_.push_back({ std::make_unique<char[]>(capacity), capacity, 0, 0 });
+    }
+    Slab& slab = slabs_.back();
+    char* const data = slab.data.get() + slab.used;
+    std::memcpy(data, word.data(), word.size());
+    slab.used += word.size();
+    slab.live_bytes += word.size();
+    live_bytes_ += word.size();
+    words_[term_id] = { data, word.size() };
+    word_slabs_[term_id] = static_cast<uint32_t>(slabs_.size() - 1);
+    return words_[term_id];
+}
+
+void TermDictionary::CompactWords() {
+    if (released_bytes_ < SLAB_SIZE || released_bytes_ <= live_bytes_) {
+        return;
+    }
+    // Sparse slabs stay alive until their words are copied
+    std::vector<Slab> old_slabs;
+    old_slabs.swap(slabs_);
+    std::vector<uint32_t> new_slab_indexes(old_slabs.size(), UINT32_MAX);
+    for (size_t i = 0; i < old_slabs.size(); ++i) {
+        if (!IsSparse(old_slabs[i])) {
+            new_slab_indexes[i] = static_cast<uint32_t>(slabs_.size());
+            slabs_.push_back(std::move(old_slabs[i]));
+        }
+    }
+    for (TermId term_id = 0; term_id < words_.size(); ++term_id) {
+        const std::string_view word = words_[term_id];
+        if (word.empty() || word_slabs_[term_id] == EXTERNAL_SLAB) {
+            continue;
+        }
+        const uint32_t new_slab_index = new_slab_indexes[word_slabs_[term_id]];
+        if (new_slab_index != UINT32_MAX) {
+            word_slabs_[term_id] = new_slab_index;
+            continue;
+        }
+        live_bytes_ -= word.size();
+        const std::string_view new_word = StoreWord(term_id, word);
+        // Keys of the extracted node can be changed without rehashing anything else
+        auto node = ids_.extract(word);
+        node.key() = new_word;
+        ids_.insert(std::move(node));
+    }
+    released_bytes_ = 0;
+    for (const Slab& slab : slabs_) {
+        released_bytes_ += slab.used - slab.live_bytes;
+    }
+}
+
+bool TermDictionary::IsSparse(const Slab& slab) const {
+    return slab.live_bytes * 2 < slab.used;
+}
\ No newline at end of file
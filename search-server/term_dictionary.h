@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using TermId = uint32_t;
+
+// Maps every distinct word to a dense integer id, ids of released words are reused.
+// Word text is appended to large slabs instead of being allocated one by one,
+// it keeps its address until CompactWords moves it out of a mostly released slab.
+class TermDictionary {
+public:
+    TermDictionary() = default;
+
+    // The copy stores the words in slabs of its own and shares the external ones
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    TermId Intern(std::string_view word);
+
+    std::optional<TermId> Find(std::string_view word) const;
+
+    std::string_view GetWord(TermId term_id) const;
+
+    void Release(TermId term_id);
+
+    // Upper bound of the ids handed out so far
+    size_t GetIdCount() const;
+
+    // Replaces the contents with words stored elsewhere, such as in a mapped snapshot,
+    // an empty word marks a free id. The text of these words is never moved or reclaimed
+    void LoadWords(const std::vector<std::string_view>& words);
+
+    // Does nothing until released words take more space than the live ones.
+    // Then words of sparse slabs are copied to new slabs and the sparse slabs are freed.
+    // Callers must refer to words by term id, views of moved words are left dangling
+    void CompactWords();
+
+private:
+    static constexpr size_t SLAB_SIZE = 64 * 1024;
+    static constexpr uint32_t EXTERNAL_SLAB = UINT32_MAX;
+
+    struct Slab {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t live_bytes = 0;
+    };
+
+    std::vector<Slab> slabs_;
+    std::vector<std::string_view> words_;
+    std::vector<uint32_t> word_slabs_;
+    std::unordered_map<std::string_view, TermId> ids_;
+    std::vector<TermId> free_ids_;
+    size_t live_bytes_ = 0;
+    size_t released_bytes_ = 0;
+
+    // Copies the word to the end of the last slab and records where it went
+    std::string_view StoreWord(TermId term_id, std::string_view word);
+
+    bool IsSparse(const Slab& slab) const;
+};
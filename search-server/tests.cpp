@@ -2,7 +2,19 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include "allocation_counter.h"
 #include "search_server.h"
+#include "concurrent_map.h"
+#include "concurrent_search_server.h"
+#include "posting_list.h"
+#include "process_queries.h"
+#include "query_result_cache.h"
+#include "remove_duplicates.h"
 
 using namespace std::string_literals;
 
@@ -249,6 +261,1025 @@ void TestCorrectCalculationRelevation() {
     ASSERT(std::abs(found_docs[2].relevance - relevance1) < EQUAL_MAX_DIFFERENCE);
 }
 
+//   
+void TestRemoveDocument() {
+    const std::vector<int> ratings = { 1, 2, 3 };
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, ratings);
+    server.AddDocument(2, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
+    server.AddDocument(3, "dog in the house"s, DocumentStatus::ACTUAL, ratings);
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    {
+        //  1     "cat"  "dog",    
+        const auto found_docs = server.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(found_docs.size(), 1u);
+        ASSERT_EQUAL(found_docs[0].id, 2);
+        const auto [matched_words, status] = server.MatchDocument("dog house"s, 3);
+        const std::vector<std::string_view> right_result = { "dog", "house" };
+        ASSERT_EQUAL(matched_words, right_result);
+    }
+    server.RemoveDocument(std::execution::par, 2);
+    ASSERT(server.FindTopDocuments("cat"s).empty());
+    ASSERT(server.GetWordFrequencies(2).empty());
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "dog"s).size(), 1u);
+}
+
+//      
+void TestMaxDocumentCount() {
+    SearchServer server(""s);
+    for (int id = 0; id < 8; ++id) {
+        server.AddDocument(id, "cat"s, DocumentStatus::ACTUAL, { id });
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 0).empty());
+    //        
+    const auto found_docs = server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 3);
+    ASSERT_EQUAL(found_docs.size(), 3u);
+    ASSERT_EQUAL(found_docs[0].id, 7);
+    ASSERT_EQUAL(found_docs[2].id, 5);
+    const auto found_docs_par = server.FindTopDocuments(std::execution::par, "cat"s, [](int id, DocumentStatus status, int rating) {
+        return id % 2 == 0;
+        }, 10);
+    ASSERT_EQUAL(found_docs_par.size(), 4u);
+    ASSERT_EQUAL(found_docs_par[0].id, 6);
+    ASSERT_EQUAL(found_docs_par[3].id, 0);
+}
+
+//    ,   
+void TestParallelSearch() {
+    SearchServer server("and"s);
+    const std::vector<std::string> words = { "cat"s, "dog"s, "rat"s, "pet"s, "hair"s, "tail"s, "nose"s };
+    for (int id = 0; id < 2000; ++id) {
+        std::string content;
+        for (int i = 0; i < 1 + id % 5; ++i) {
+            content += words[(id * 7 + i * 3) % words.size()] + " and "s;
+        }
+        server.AddDocument(id * 3, content, static_cast<DocumentStatus>(id % 4), { id % 11 });
+    }
+    for (const std::string& query : { "cat dog"s, "rat -pet"s, "hair tail nose -cat"s, "fox"s }) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto seq_docs = server.FindTopDocuments(std::execution::seq, query, status, 20);
+            const auto par_docs = server.FindTopDocuments(std::execution::par, query, status, 20);
+            ASSERT_EQUAL(seq_docs.size(), par_docs.size());
+            for (size_t i = 0; i < seq_docs.size(); ++i) {
+                ASSERT_EQUAL(seq_docs[i].id, par_docs[i].id);
+                ASSERT(std::abs(seq_docs[i].relevance - par_docs[i].relevance) < EQUAL_MAX_DIFFERENCE);
+            }
+        }
+    }
+}
+
+//      
+void TestConcurrentMap() {
+    const int thread_count = 8;
+    const int key_count = 1000;
+    const int iterations = 20000;
+    ConcurrentMap<int, int> map(4);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < thread_count; ++thread) {
+        threads.emplace_back([&map, thread]() {
+            for (int i = 0; i < iterations; ++i) {
+                const int key = (i * 31 + thread) % key_count;
+                switch (i % 4) {
+                case 0:
+                    map[key].ref_to_value += 1;
+                    break;
+                case 1:
+                    map.Update(key, [](int& value) { value += 1; });
+                    break;
+                case 2:
+                    map.Emplace(key + key_count, 1);
+                    break;
+                default:
+                    map.Erase(key + key_count);
+                }
+            }
+            });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    //      [0, key_count)
+    int total = 0;
+    for (const auto& [key, value] : map.BuildOrdinaryMap()) {
+        if (key < key_count) {
+            total += value;
+        }
+    }
+    ASSERT_EQUAL(total, thread_count * iterations / 2);
+
+    std::vector<std::pair<int, int>> increments;
+    std::vector<int> keys;
+    for (int key = 0; key < key_count; ++key) {
+        increments.push_back({ key, 10 });
+        keys.push_back(key + key_count);
+    }
+    map.UpdateBatch(increments, [](int& value, int increment) { value += increment; });
+    map.EraseBatch(keys);
+    ASSERT_EQUAL(map.Size(), static_cast<size_t>(key_count));
+    int value = 0;
+    ASSERT(map.Visit(0, [&value](const int& stored) { value = stored; }));
+    ASSERT(value >= 10);
+    ASSERT(!map.Visit(-1, [](const int&) {}));
+}
+
+//IDF      
+void TestRelevanceAfterCorpusChange() {
+    SearchServer server(""s);
+    server.AddDocument(1, " "s, DocumentStatus::ACTUAL, {});
+    server.AddDocument(2, " "s, DocumentStatus::ACTUAL, {});
+    ASSERT(std::abs(server.FindTopDocuments(""s)[0].relevance - 0.5 * log(2)) < EQUAL_MAX_DIFFERENCE);
+    server.AddDocument(3, " "s, DocumentStatus::ACTUAL, {});
+    server.AddDocument(4, " "s, DocumentStatus::ACTUAL, {});
+    ASSERT(std::abs(server.FindTopDocuments(""s)[0].relevance - 0.5 * log(2)) < EQUAL_MAX_DIFFERENCE);
+    ASSERT(std::abs(server.FindTopDocuments(""s)[0].relevance - 0.5 * log(4)) < EQUAL_MAX_DIFFERENCE);
+    server.RemoveDocument(1);
+    ASSERT(std::abs(server.FindTopDocuments(""s)[0].relevance - 0.5 * log(3)) < EQUAL_MAX_DIFFERENCE);
+    ASSERT(std::abs(server.FindTopDocuments(""s)[0].relevance - 0.5 * log(3)) < EQUAL_MAX_DIFFERENCE);
+}
+
+//     
+void TestDocumentTermIds() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "nasty rat with funny funny pet"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(3, "funny pet"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(server.GetDocumentTermIds(1).size(), 4u);
+    ASSERT(server.GetDocumentTermIds(1) == server.GetDocumentTermIds(2));
+    ASSERT(server.GetDocumentTermIds(1) != server.GetDocumentTermIds(3));
+    ASSERT(server.GetDocumentTermIds(4).empty());
+    // ,    ,    
+    const auto [matched_words, status] = server.MatchDocument("pet funny -cat"s, 3);
+    const std::vector<std::string_view> right_result = { "funny", "pet" };
+    ASSERT_EQUAL(matched_words, right_result);
+}
+
+//     ,   
+void TestWordStorageCompaction() {
+    SearchServer server("and with"s);
+    //        ,
+    //       
+    const int document_count = 3000;
+    for (int id = 0; id < document_count; ++id) {
+        server.AddDocument(id, "funny word"s + std::to_string(id) + std::string(40, 'x') + " cat"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    for (int id = 0; id < document_count; ++id) {
+        if (id % 10 != 0) {
+            server.RemoveDocument(id);
+        }
+    }
+    ASSERT_EQUAL(server.GetDocumentCount(), document_count / 10);
+    for (int id = 0; id < document_count; id += 10) {
+        const std::string word = "word"s + std::to_string(id) + std::string(40, 'x');
+        const auto& word_freqs = server.GetWordFrequencies(id);
+        ASSERT_EQUAL(word_freqs.size(), 3u);
+        ASSERT(word_freqs.count(word) == 1);
+        ASSERT(word_freqs.count("cat"s) == 1);
+        const auto [matched_words, status] = server.MatchDocument(word + " cat"s, id);
+        ASSERT_EQUAL(matched_words.size(), 2u);
+        ASSERT(matched_words[0] == "cat"s);
+        ASSERT(matched_words[1] == word);
+        const auto found = server.FindTopDocuments(word);
+        ASSERT_EQUAL(found.size(), 1u);
+        ASSERT_EQUAL(found[0].id, id);
+    }
+}
+
+//      ,     
+void TestAddDocuments() {
+    const std::vector<std::string> texts = {
+        "funny pet and nasty rat"s,
+        "funny pet with curly hair"s,
+        "nasty rat with curly hair and curly tail"s,
+        "and with"s,
+        "pet pet pet"s
+    };
+    const std::vector<int> ids = { 7, 3, 12, 5, 1 };
+    std::vector<SearchServer::NewDocument> batch;
+    SearchServer expected("and with"s);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const DocumentStatus status = i == 2 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        batch.push_back({ ids[i], texts[i], status, { static_cast<int>(i), 4 } });
+        expected.AddDocument(ids[i], texts[i], status, { static_cast<int>(i), 4 });
+    }
+    //     ,  id   
+    SearchServer server_seq("and with"s);
+    SearchServer server_par("and with"s);
+    for (SearchServer* server : { &server_seq, &server_par, &expected }) {
+        server->AddDocument(4, "curly pet"s, DocumentStatus::ACTUAL, { 2 });
+    }
+    server_seq.AddDocuments(batch);
+    server_par.AddDocuments(std::execution::par, batch);
+    for (const SearchServer* server : { &server_seq, &server_par }) {
+        ASSERT_EQUAL(server->GetDocumentCount(), expected.GetDocumentCount());
+        ASSERT(std::equal(server->begin(), server->end(), expected.begin(), expected.end()));
+        for (const int id : expected) {
+            ASSERT(server->GetWordFrequencies(id) == expected.GetWordFrequencies(id));
+        }
+        for (const std::string& query : { "curly pet"s, "nasty -hair"s, "rat tail"s }) {
+            const auto found = server->FindTopDocuments(query);
+            const auto right_result = expected.FindTopDocuments(query);
+            ASSERT_EQUAL(found.size(), right_result.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, right_result[i].id);
+                ASSERT(std::abs(found[i].relevance - right_result[i].relevance) < EQUAL_MAX_DIFFERENCE);
+            }
+        }
+    }
+    //          
+    std::vector<SearchServer::NewDocument> wrong_batches[] = {
+        { { 20, "cat"s, DocumentStatus::ACTUAL, {} }, { 4, "dog"s, DocumentStatus::ACTUAL, {} } },
+        { { 20, "cat"s, DocumentStatus::ACTUAL, {} }, { 20, "dog"s, DocumentStatus::ACTUAL, {} } },
+        { { 20, "cat"s, DocumentStatus::ACTUAL, {} }, { -1, "dog"s, DocumentStatus::ACTUAL, {} } },
+        { { 20, "cat"s, DocumentStatus::ACTUAL, {} }, { 21, "d\x12og"s, DocumentStatus::ACTUAL, {} } }
+    };
+    for (const auto& wrong_batch : wrong_batches) {
+        try {
+            server_par.AddDocuments(std::execution::par, wrong_batch);
+            ASSERT_HINT(false, "Invalid batch must throw"s);
+        }
+        catch (const std::invalid_argument&) {
+        }
+        ASSERT_EQUAL(server_par.GetDocumentCount(), expected.GetDocumentCount());
+        ASSERT(server_par.FindTopDocuments("cat"s).empty());
+    }
+}
+
+//,   ,     ,  
+void TestSnapshot() {
+    const std::string path = "search_server_test.snapshot"s;
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+    server.AddDocument(5, "nasty rat with curly tail"s, DocumentStatus::ACTUAL, { 3 });
+    server.AddDocument(8, "very nasty cat"s, DocumentStatus::ACTUAL, { 5 });
+    //  id         
+    server.RemoveDocument(8);
+    server.SaveSnapshot(path);
+    {
+        SearchServer loaded = SearchServer::LoadSnapshot(path);
+        ASSERT_EQUAL(loaded.GetDocumentCount(), server.GetDocumentCount());
+        ASSERT(std::equal(loaded.begin(), loaded.end(), server.begin(), server.end()));
+        for (const int id : server) {
+            ASSERT(loaded.GetWordFrequencies(id) == server.GetWordFrequencies(id));
+            ASSERT(loaded.GetDocumentTermIds(id) == server.GetDocumentTermIds(id));
+        }
+        const auto check_queries = [&server](const SearchServer& other) {
+            for (const std::string& query : { "curly rat"s, "nasty -hair"s, "funny pet with"s }) {
+                for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+                    const auto found = other.FindTopDocuments(query, status);
+                    const auto right_result = server.FindTopDocuments(query, status);
+                    ASSERT_EQUAL(found.size(), right_result.size());
+                    for (size_t i = 0; i < found.size(); ++i) {
+                        ASSERT_EQUAL(found[i].id, right_result[i].id);
+                        ASSERT_EQUAL(found[i].rating, right_result[i].rating);
+                        ASSERT(std::abs(found[i].relevance - right_result[i].relevance) < EQUAL_MAX_DIFFERENCE);
+                    }
+                }
+            }
+        };
+        check_queries(loaded);
+        ASSERT(loaded.FindTopDocuments("cat"s).empty());
+        //       
+        for (SearchServer* target : { &server, &loaded }) {
+            target->AddDocument(3, "curly cat"s, DocumentStatus::ACTUAL, { 1 });
+            target->RemoveDocument(5);
+        }
+        //   ,      
+        loaded.SaveSnapshot(path);
+        check_queries(loaded);
+        check_queries(SearchServer::LoadSnapshot(path));
+    }
+    {
+        //       , id    
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-static_cast<std::streamoff>(sizeof(DocumentTerm)), std::ios::end);
+        const TermId unknown_term_id = 1000;
+        file.write(reinterpret_cast<const char*>(&unknown_term_id), sizeof(unknown_term_id));
+    }
+    try {
+        SearchServer::LoadSnapshot(path);
+        ASSERT_HINT(false, "Unknown term id in a snapshot must throw"s);
+    }
+    catch (const std::runtime_error&) {
+    }
+    {
+        //         20    ,
+        //    16  ,     8 
+        SearchServer small_server("and with"s);
+        small_server.AddDocument(1, "funny pet"s, DocumentStatus::ACTUAL, { 1 });
+        small_server.AddDocument(2, "nasty rat"s, DocumentStatus::ACTUAL, { 2 });
+        small_server.RemoveDocument(2);
+        small_server.SaveSnapshot(path);
+        const auto padded = [](std::streamoff size) {
+            return (size + 7) / 8 * 8;
+        };
+        const std::streamoff terms_size = 16 + 2 * sizeof(DocumentTerm);
+        const std::streamoff records_size = 16 + padded(20);
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-(terms_size + records_size + padded(sizeof(uint32_t))), std::ios::end);
+        const uint32_t free_ordinal = 1000;
+        file.write(reinterpret_cast<const char*>(&free_ordinal), sizeof(free_ordinal));
+    }
+    try {
+        SearchServer::LoadSnapshot(path);
+        ASSERT_HINT(false, "Free ordinal out of range in a snapshot must throw"s);
+    }
+    catch (const std::runtime_error&) {
+    }
+    std::remove(path.c_str());
+    try {
+        SearchServer::LoadSnapshot(path);
+        ASSERT_HINT(false, "Missing snapshot must throw"s);
+    }
+    catch (const std::runtime_error&) {
+    }
+}
+
+//     ,      
+void TestFindTopDocumentsBatch() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(3, "nasty rat with curly tail"s, DocumentStatus::BANNED, { 3 });
+    server.AddDocument(4, "big dog and curly cat"s, DocumentStatus::ACTUAL, { 5 });
+    server.AddDocument(5, "nasty dog"s, DocumentStatus::ACTUAL, { 4 });
+    //  ,     ,   
+    std::vector<std::string> queries;
+    for (const std::string& word : { "funny"s, "nasty"s, "curly"s, "dog"s }) {
+        queries.push_back(word);
+        queries.push_back(word + " rat"s);
+        queries.push_back(word + " -pet"s);
+        queries.push_back("curly " + word + " -tail"s);
+    }
+    queries.push_back("unknown"s);
+    queries.push_back("and -with"s);
+    //      ,   
+    queries.push_back("funny pet nasty rat curly hair tail -big"s);
+    queries.push_back("funny pet nasty rat curly hair tail dog cat"s);
+    for (const auto& results : { server.FindTopDocumentsBatch(queries), server.FindTopDocumentsBatch(std::execution::par, queries) }) {
+        ASSERT_EQUAL(results.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto right_result = server.FindTopDocuments(queries[i]);
+            ASSERT_EQUAL(results[i].size(), right_result.size());
+            for (size_t j = 0; j < right_result.size(); ++j) {
+                ASSERT_EQUAL(results[i][j].id, right_result[j].id);
+                ASSERT_EQUAL(results[i][j].rating, right_result[j].rating);
+                ASSERT(results[i][j].relevance == right_result[j].relevance);
+            }
+        }
+    }
+    try {
+        server.FindTopDocumentsBatch({ "cat"s, "--dog"s });
+        ASSERT_HINT(false, "Invalid query must throw"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+}
+
+//        
+void TestProcessQueriesJoined() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(3, "nasty rat with curly tail"s, DocumentStatus::ACTUAL, { 3 });
+    server.AddDocument(4, "big dog and curly cat"s, DocumentStatus::ACTUAL, { 5 });
+    std::vector<std::string> queries;
+    for (int i = 0; i < 10; ++i) {
+        queries.push_back(i % 3 == 0 ? "unknown"s : i % 3 == 1 ? "curly -dog"s : "nasty pet"s);
+    }
+    const auto results = ProcessQueries(server, queries);
+    const JoinedDocuments joined = ProcessQueriesJoined(server, queries);
+    ASSERT_EQUAL(joined.GetQueryCount(), queries.size());
+    std::vector<int> expected_ids;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto [first, last] = joined.GetQueryDocuments(i);
+        ASSERT_EQUAL(static_cast<size_t>(last - first), results[i].size());
+        for (const Document& document : results[i]) {
+            expected_ids.push_back(document.id);
+        }
+    }
+    std::vector<int> joined_ids;
+    for (const Document& document : joined) {
+        joined_ids.push_back(document.id);
+    }
+    ASSERT_EQUAL(joined_ids, expected_ids);
+    ASSERT_EQUAL(joined.size(), expected_ids.size());
+    //         
+    std::vector<int> calls(queries.size());
+    std::vector<std::vector<Document>> streamed(queries.size());
+    ProcessQueriesStreaming(server, queries, [&](size_t query_index, const std::vector<Document>& documents) {
+        ++calls[query_index];
+        streamed[query_index] = documents;
+        });
+    ASSERT(std::all_of(calls.begin(), calls.end(), [](int count) { return count == 1; }));
+    for (size_t i = 0; i < queries.size(); ++i) {
+        ASSERT_EQUAL(streamed[i].size(), results[i].size());
+        for (size_t j = 0; j < streamed[i].size(); ++j) {
+            ASSERT_EQUAL(streamed[i][j].id, results[i][j].id);
+        }
+    }
+}
+
+//          
+void TestPostingList() {
+    //   ,     ,
+    //       
+    PostingList postings;
+    std::vector<Posting> expected;
+    for (int i = 0; i < 1000; ++i) {
+        const int document_id = (i * 7919) % 1000 * 3;
+        const Posting posting{ document_id, static_cast<uint32_t>(i), static_cast<uint32_t>(i % 5 + 1) };
+        postings.Add(posting);
+        expected.insert(std::upper_bound(expected.begin(), expected.end(), document_id, [](int id, const Posting& other) {
+            return id < other.document_id;
+            }), posting);
+    }
+    for (int document_id = 0; document_id < 3000; document_id += 9) {
+        ASSERT(postings.Erase(document_id));
+        ASSERT(!postings.Erase(document_id));
+        expected.erase(std::find_if(expected.begin(), expected.end(), [document_id](const Posting& posting) {
+            return posting.document_id == document_id;
+            }));
+    }
+    ASSERT(!postings.Erase(1));
+    ASSERT_EQUAL(postings.size(), expected.size());
+    const PostingView view = postings.GetView();
+    const std::vector<Posting> decoded = view.Decode();
+    ASSERT_EQUAL(decoded.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(decoded[i].document_id, expected[i].document_id);
+        ASSERT_EQUAL(decoded[i].document_ordinal, expected[i].document_ordinal);
+        ASSERT_EQUAL(decoded[i].count, expected[i].count);
+    }
+    //       
+    std::vector<int> range_ids;
+    view.ForEach([&range_ids](const Posting& posting) {
+        range_ids.push_back(posting.document_id);
+        }, 1000, 2000);
+    ASSERT_EQUAL(range_ids.size(), static_cast<size_t>(std::count_if(expected.begin(), expected.end(), [](const Posting& posting) {
+        return posting.document_id >= 1000 && posting.document_id < 2000;
+        })));
+    ASSERT(std::is_sorted(range_ids.begin(), range_ids.end()));
+    ASSERT(range_ids.front() >= 1000 && range_ids.back() < 2000);
+}
+
+//        
+void TestSplitIntoValidWords() {
+    //      ,    
+    //         
+    const std::string alphabet = "ab  \xd0\xff\t\x01"s;
+    std::vector<std::string_view> words;
+    uint32_t state = 1;
+    for (size_t length = 0; length < 300; ++length) {
+        for (int attempt = 0; attempt < 20; ++attempt) {
+            std::string text;
+            for (size_t i = 0; i < length; ++i) {
+                state = state * 1103515245u + 12345u;
+                //   ,      
+                const size_t letter = (state >> 16) % 1000 < 5 ? 6 + (state >> 8) % 2 : (state >> 16) % 6;
+                text += alphabet[letter];
+            }
+            std::vector<std::string_view> expected;
+            bool expected_valid = true;
+            for (size_t pos = 0; pos < text.size() && expected_valid;) {
+                const size_t end = std::min(text.find(' ', pos), text.size());
+                if (end > pos) {
+                    expected.push_back(std::string_view(text).substr(pos, end - pos));
+                    expected_valid = IsValidWord(expected.back());
+                }
+                pos = end + 1;
+            }
+            ASSERT_EQUAL(SplitIntoValidWords(text, words), expected_valid);
+            ASSERT(words == expected);
+        }
+    }
+    ASSERT(SplitIntoWords("  cat \x01 dog  "s) == std::vector<std::string_view>({ "cat", "\x01", "dog" }));
+}
+
+//      
+void TestMaxScoreMatchesFullScoring() {
+    //            
+    //    ,    ,     
+    SearchServer server("and"s);
+    uint32_t state = 7;
+    const auto next_word = [&state]() {
+        state = state * 1103515245u + 12345u;
+        const uint32_t value = (state >> 16) % 1000;
+        //    ,     
+        return "w"s + std::to_string(value * value / 10000);
+    };
+    for (int id = 0; id < 3000; ++id) {
+        std::string text;
+        for (int i = 0; i < 3 + id % 17; ++i) {
+            text += next_word() + " "s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 11 - 5 });
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < 100; ++i) {
+        std::string query = next_word() + " "s + next_word() + " "s + next_word();
+        if (i % 3 == 0) {
+            query += " -"s + next_word();
+        }
+        queries.push_back(query);
+    }
+    const std::vector<std::vector<Document>> batch_results = server.FindTopDocumentsBatch(queries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (const std::vector<Document>& found : { server.FindTopDocuments(queries[i]), server.FindTopDocuments(std::execution::par, queries[i]) }) {
+            ASSERT_EQUAL_HINT(found.size(), batch_results[i].size(), queries[i]);
+            for (size_t j = 0; j < found.size(); ++j) {
+                ASSERT_EQUAL_HINT(found[j].id, batch_results[i][j].id, queries[i]);
+                ASSERT_HINT(found[j].relevance == batch_results[i][j].relevance, queries[i]);
+            }
+        }
+    }
+}
+
+//       
+void TestStatusAfterOrdinalReuse() {
+    //         ,
+    //       
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat"s, DocumentStatus::BANNED, { 1 });
+    server.AddDocument(2, "black cat"s, DocumentStatus::ACTUAL, { 2 });
+    server.RemoveDocument(1);
+    server.AddDocument(3, "grey cat"s, DocumentStatus::IRRELEVANT, { 3 });
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::BANNED).empty());
+    const auto irrelevant = server.FindTopDocuments(std::execution::par, "cat"s, DocumentStatus::IRRELEVANT);
+    ASSERT_EQUAL(irrelevant.size(), 1u);
+    ASSERT_EQUAL(irrelevant[0].id, 3);
+    const auto actual = server.FindTopDocuments("cat -black"s);
+    ASSERT(actual.empty());
+    //     
+    try {
+        server.AddDocument(4, "cat"s, static_cast<DocumentStatus>(DOCUMENT_STATUS_COUNT), { 1 });
+        ASSERT_HINT(false, "    "s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+}
+
+//  ,   
+void TestDocumentMetadataAfterOrdinalReuse() {
+    //     ,       ,
+    //      id   
+    SearchServer server("and"s);
+    server.AddDocument(5, "white cat"s, DocumentStatus::ACTUAL, { 5 });
+    server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, { 2 });
+    server.RemoveDocument(5);
+    server.AddDocument(9, "white parrot"s, DocumentStatus::ACTUAL, { 9 });
+    server.AddDocument(1, "grey cat"s, DocumentStatus::ACTUAL, { 1 });
+    const std::vector<int> ids(server.begin(), server.end());
+    ASSERT(ids == std::vector<int>({ 1, 2, 9 }));
+    const auto found = server.FindTopDocuments("white"s);
+    ASSERT_EQUAL(found.size(), 1u);
+    ASSERT_EQUAL(found[0].id, 9);
+    ASSERT_EQUAL(found[0].rating, 9);
+    ASSERT_EQUAL(server.GetWordFrequencies(9).count(std::string_view("parrot")), 1u);
+    ASSERT_EQUAL(server.GetWordFrequencies(9).count(std::string_view("cat")), 0u);
+    const auto [words, status] = server.MatchDocument("cat parrot"s, 9);
+    ASSERT(words == std::vector<std::string_view>({ std::string_view("parrot") }));
+    ASSERT(status == DocumentStatus::ACTUAL);
+}
+
+//        
+void TestPurgeRemovedDocuments() {
+    SearchServer server("and"s);
+    //   "cat"   ,    
+    const int document_count = 1000;
+    for (int id = 0; id < document_count; ++id) {
+        server.AddDocument(id, "cat word"s + std::to_string(id), DocumentStatus::ACTUAL, { id });
+    }
+    for (int id = 0; id < document_count; id += 3) {
+        server.RemoveDocument(id);
+    }
+    const int live_count = document_count - (document_count + 2) / 3;
+    ASSERT_EQUAL(server.GetDocumentCount(), live_count);
+    //      ,   , IDF   
+    const auto check_search = [&server, live_count]() {
+        const auto found = server.FindTopDocuments("cat word999 word3"s, [](int id, DocumentStatus, int) {
+            return true;
+            }, document_count);
+        ASSERT_EQUAL(found.size(), static_cast<size_t>(live_count));
+        ASSERT_EQUAL(found[0].id, 998);
+        for (const Document& document : found) {
+            ASSERT(document.id % 3 != 0);
+        }
+        ASSERT(server.FindTopDocuments("word3"s).empty());
+        ASSERT(std::abs(server.FindTopDocuments("word1"s)[0].relevance - 0.5 * log(live_count)) < EQUAL_MAX_DIFFERENCE);
+    };
+    check_search();
+    //      id ,     
+    server.AddDocument(999, "dog"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s).size(), 1u);
+    ASSERT(server.FindTopDocuments("word999"s).empty());
+    server.RemoveDocument(999);
+    server.PurgeRemovedDocuments(std::execution::par);
+    check_search();
+    //     
+    server.AddDocument(document_count, "word3 word6"s, DocumentStatus::ACTUAL, { 1 });
+    const auto found = server.FindTopDocuments("word3"s);
+    ASSERT_EQUAL(found.size(), 1u);
+    ASSERT(std::abs(found[0].relevance - 0.5 * log(live_count + 1)) < EQUAL_MAX_DIFFERENCE);
+}
+
+//       
+void TestConcurrentReadersAndWriter() {
+    ConcurrentSearchServer server("and"s);
+    const int document_count = 200;
+    std::atomic<bool> writing{ true };
+    std::atomic<int> read_count{ 0 };
+    const auto read = [&server, &writing, &read_count, document_count](int reader) {
+        while (writing.load()) {
+            //       ,     .
+            //     "cat"      "dog"
+            server.Read([reader, document_count](const SearchServer& replica) {
+                const auto found = replica.FindTopDocuments("cat"s, [](int, DocumentStatus, int) {
+                    return true;
+                    }, document_count);
+                ASSERT_EQUAL(found.size() + 1, static_cast<size_t>(replica.GetDocumentCount()));
+                for (size_t i = 0; i < std::min<size_t>(found.size(), 5); ++i) {
+                    const auto [words, status] = replica.MatchDocument("cat word"s + std::to_string(found[i].id), found[i].id);
+                    ASSERT_EQUAL(words.size(), 2u);
+                }
+                ASSERT(replica.FindTopDocuments("word"s + std::to_string(reader)).size() <= 1u);
+                });
+            const auto [words, status] = server.MatchDocument("dog"s, document_count);
+            ASSERT(words.size() == 1u && words[0] == "dog"s);
+            ++read_count;
+        }
+    };
+    server.AddDocument(document_count, "dog"s, DocumentStatus::ACTUAL, { 1 });
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 3; ++reader) {
+        readers.emplace_back(read, reader);
+    }
+    //     ,      
+    while (read_count.load() < 3) {
+        std::this_thread::yield();
+    }
+    for (int id = 0; id < document_count; ++id) {
+        server.AddDocument(id, "cat word"s + std::to_string(id), DocumentStatus::ACTUAL, { id });
+        if (id % 2 == 1) {
+            server.RemoveDocument(id - 1);
+        }
+    }
+    server.PurgeRemovedDocuments();
+    writing = false;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQUAL(server.GetDocumentCount(), document_count / 2 + 1);
+    const auto found = server.FindTopDocuments("cat word1"s);
+    ASSERT_EQUAL(found[0].id, 1);
+    //         
+    try {
+        server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, { 1 });
+        ASSERT_HINT(false, "   id "s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+    //       ,   
+    for (int i = 0; i < 2; ++i) {
+        server.RemoveDocument(document_count);
+        ASSERT(server.FindTopDocuments("dog"s).empty());
+    }
+}
+
+//,   ,     
+void TestConcurrentWriteFailure() {
+    ConcurrentSearchServer server("and"s);
+    server.AddDocument(1, "funny pet"s, DocumentStatus::ACTUAL, { 1 });
+    //        ,      .
+    //       ,    
+    size_t found_count = 0;
+    for (size_t allowed = 0; found_count == 0; ++allowed) {
+        SetThreadAllocationLimit(allowed);
+        try {
+            server.AddDocument(2, "nasty rat"s, DocumentStatus::ACTUAL, { 2 });
+        }
+        catch (const std::bad_alloc&) {
+        }
+        SetThreadAllocationLimit(SIZE_MAX);
+        found_count = server.FindTopDocuments("rat"s).size();
+        //       ,   
+        for (int i = 0; i < 2; ++i) {
+            server.RemoveDocument(100);
+            ASSERT_EQUAL(server.FindTopDocuments("rat"s).size(), found_count);
+            ASSERT_EQUAL(server.GetDocumentCount(), static_cast<int>(found_count) + 1);
+        }
+    }
+    server.AddDocument(3, "nasty cat"s, DocumentStatus::ACTUAL, { 3 });
+    for (int i = 0; i < 2; ++i) {
+        server.RemoveDocument(100);
+        ASSERT_EQUAL(server.FindTopDocuments("nasty"s).size(), 2u);
+    }
+}
+
+//,    ,        
+void TestSegmentedIndex() {
+    //     ,       
+    const int words_per_document = 64;
+    const int document_count = static_cast<int>(3 * InvertedIndex::BUFFER_POSTING_COUNT / words_per_document) + 101;
+    std::vector<std::string> texts(document_count);
+    SearchServer server("and"s);
+    for (int i = 0; i < document_count; ++i) {
+        const int id = static_cast<int>(i * 7919LL % document_count);
+        for (int word = 0; word < words_per_document; ++word) {
+            texts[id] += "w"s + std::to_string((id + word * word) % 211) + " "s;
+        }
+        server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id % 7 });
+    }
+    //   ,      id,     
+    std::vector<SearchServer::NewDocument> documents;
+    for (int id = 0; id < document_count; ++id) {
+        documents.push_back({ id, texts[id], DocumentStatus::ACTUAL, { id % 7 } });
+    }
+    SearchServer batch_server("and"s);
+    batch_server.AddDocuments(documents);
+    const auto check_search = [&server, &batch_server]() {
+        for (const std::string& query : { "w1 w5 -w17"s, "w100 w3"s, "w7 w8 w9 w10 -w200"s, "w210"s }) {
+            const auto expected = batch_server.FindTopDocuments(query);
+            ASSERT_EQUAL(expected.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+            for (const auto& found : { server.FindTopDocuments(query), server.FindTopDocuments(std::execution::par, query) }) {
+                ASSERT_EQUAL(found.size(), expected.size());
+                for (size_t i = 0; i < found.size(); ++i) {
+                    ASSERT_EQUAL(found[i].id, expected[i].id);
+                    ASSERT(std::abs(found[i].relevance - expected[i].relevance) < EQUAL_MAX_DIFFERENCE);
+                }
+            }
+        }
+    };
+    check_search();
+    //       
+    for (int id = 0; id < document_count; id += 5) {
+        server.RemoveDocument(id);
+        batch_server.RemoveDocument(id);
+    }
+    server.PurgeRemovedDocuments();
+    check_search();
+}
+
+//   ,     
+void TestQueryResultCache() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, { 8 });
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7 });
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, { 5 });
+    QueryResultCache cache(server, 2);
+    const auto check_found = [&server, &cache](const std::string& query, DocumentStatus status) {
+        const auto expected = server.FindTopDocuments(query, status);
+        const auto found = cache.FindTopDocuments(query, status);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+        }
+    };
+    const auto check_statistics = [&cache](uint64_t hit_count, uint64_t miss_count) {
+        const QueryResultCache::Statistics statistics = cache.GetStatistics();
+        ASSERT_EQUAL(statistics.hit_count, hit_count);
+        ASSERT_EQUAL(statistics.miss_count, miss_count);
+    };
+    ASSERT_EQUAL(cache.GetStatistics().GetHitRate(), 0.0);
+    check_found("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    check_statistics(0, 1);
+    //  , , -  ,    ,    
+    check_found("cat and fluffy -dog fluffy parrot"s, DocumentStatus::ACTUAL);
+    check_statistics(1, 1);
+    ASSERT_EQUAL(cache.GetStatistics().GetHitRate(), 0.5);
+    //    
+    check_found("fluffy cat -dog"s, DocumentStatus::BANNED);
+    check_statistics(1, 2);
+    //     
+    check_found("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    check_found("dog"s, DocumentStatus::BANNED);
+    check_found("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    check_statistics(3, 3);
+    check_found("fluffy cat -dog"s, DocumentStatus::BANNED);
+    check_statistics(3, 4);
+    //        
+    server.AddDocument(4, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    check_found("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    check_statistics(3, 5);
+    server.RemoveDocument(2);
+    check_found("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    check_statistics(3, 6);
+    //     
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < 4; ++thread) {
+        threads.emplace_back([&check_found, thread]() {
+            for (int i = 0; i < 100; ++i) {
+                check_found((i + thread) % 3 == 0 ? "cat"s : "white collar"s, DocumentStatus::ACTUAL);
+            }
+            });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const QueryResultCache::Statistics statistics = cache.GetStatistics();
+    ASSERT_EQUAL(statistics.hit_count + statistics.miss_count, 409u);
+    // ,     ,  
+    ASSERT(statistics.miss_count <= 6u + 2u * threads.size());
+}
+
+//         
+void TestQueryWithoutAllocations() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, { 8 });
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7 });
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, { 5 });
+    server.AddDocument(4, "groomed starling with fluffy tail"s, DocumentStatus::ACTUAL, { 3 });
+    const std::vector<std::string> queries = { "fluffy groomed cat"s, "fluffy -collar"s, "dog eyes -cat and"s, "parrot"s };
+    SearchServer::QueryContext context;
+    //     
+    for (const std::string& query : queries) {
+        server.FindTopDocuments(context, query);
+        server.FindTopDocuments(context, query, DocumentStatus::BANNED);
+    }
+    for (const std::string& query : queries) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const std::vector<Document> expected = server.FindTopDocuments(query, status);
+            const size_t allocations_before = GetThreadAllocationCount();
+            const std::vector<Document>& found = server.FindTopDocuments(context, query, status);
+            //     ,    
+            const size_t allocations = GetThreadAllocationCount() - allocations_before;
+            ASSERT_EQUAL_HINT(allocations, 0u, query);
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+            }
+        }
+    }
+    //         
+    const size_t allocations_before = GetThreadAllocationCount();
+    const std::vector<Document> found = server.FindTopDocuments(queries[0]);
+    const size_t allocations = GetThreadAllocationCount() - allocations_before;
+    ASSERT_EQUAL(allocations, 1u);
+    ASSERT_EQUAL(found.size(), 3u);
+}
+
+//      ,   -   
+void TestFindDuplicates() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    //    ,   -    
+    server.AddDocument(3, "nasty rat funny pet funny and"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(4, "curly hair with funny pet"s, DocumentStatus::BANNED, { 1, 2 });
+    server.AddDocument(5, "funny pet and nasty rat curly"s, DocumentStatus::ACTUAL, { 1, 2 });
+    server.AddDocument(6, "very nice dog"s, DocumentStatus::ACTUAL, { 1, 2 });
+    ASSERT(server.GetDocumentFingerprint(1) == server.GetDocumentFingerprint(3));
+    ASSERT(server.GetDocumentFingerprint(1) != server.GetDocumentFingerprint(5));
+    ASSERT(FindDuplicates(server) == std::vector<int>({ 3, 4 }));
+    //   1  5  4   5
+    ASSERT(FindNearDuplicates(server, 1.0) == std::vector<int>({ 3, 4 }));
+    ASSERT(FindNearDuplicates(server, 0.8) == std::vector<int>({ 3, 4, 5 }));
+    ASSERT(FindNearDuplicates(server, 0.9) == std::vector<int>({ 3, 4 }));
+    try {
+        FindNearDuplicates(server, 0.0);
+        ASSERT_HINT(false, "Zero similarity threshold must throw"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+    //    ,       id 
+    const std::string path = "duplicates_test.snapshot"s;
+    server.SaveSnapshot(path);
+    {
+        const SearchServer loaded = SearchServer::LoadSnapshot(path);
+        ASSERT(loaded.GetDocumentFingerprint(3) == server.GetDocumentFingerprint(3));
+        ASSERT(FindDuplicates(loaded) == std::vector<int>({ 3, 4 }));
+    }
+    std::remove(path.c_str());
+    server.RemoveDocuments(std::execution::par, FindDuplicates(server));
+    ASSERT_EQUAL(server.GetDocumentCount(), 4);
+    ASSERT(FindDuplicates(server).empty());
+    ASSERT(server.FindTopDocuments("curly"s).size() == 2);
+}
+
+//       
+void TestWordFrequencies() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "funny pet and funny rat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "curly dog"s, DocumentStatus::ACTUAL, { 1 });
+    const WordFrequencies word_freqs = server.GetWordFrequencies(1);
+    ASSERT_EQUAL(word_freqs.size(), 3u);
+    ASSERT_EQUAL(word_freqs.at("funny"s), 0.5);
+    ASSERT_EQUAL(word_freqs.at("rat"s), 0.25);
+    ASSERT_EQUAL(word_freqs.count("and"s), 0u);
+    //       ,     
+    ASSERT_EQUAL(word_freqs.count("dog"s), 0u);
+    try {
+        word_freqs.at("dog"s);
+        ASSERT_HINT(false, "Absent word must throw"s);
+    }
+    catch (const std::out_of_range&) {
+    }
+    double freq_sum = 0.0;
+    for (const auto [word, freq] : word_freqs) {
+        ASSERT_EQUAL(word_freqs.at(word), freq);
+        freq_sum += freq;
+    }
+    ASSERT_EQUAL(freq_sum, 1.0);
+    ASSERT(word_freqs != server.GetWordFrequencies(2));
+    ASSERT(server.GetWordFrequencies(3).empty());
+    ASSERT_EQUAL(server.GetWordFrequencies(3).count("funny"s), 0u);
+    //      
+    SearchServer other("and"s);
+    other.AddDocument(1, "rat funny pet funny"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT(other.GetWordFrequencies(1) == server.GetWordFrequencies(1));
+}
+
+//       
+void TestMatchDocumentsBatch() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+    server.AddDocument(3, "nasty rat with curly tail"s, DocumentStatus::ACTUAL, { 3 });
+    server.AddDocument(4, "very nasty cat"s, DocumentStatus::IRRELEVANT, { 5 });
+    const std::vector<int> document_ids = { 4, 1, 3, 2 };
+    for (const std::string& query : { "curly nasty pet"s, "nasty -hair"s, "cat tail -dog"s, "dog"s }) {
+        const auto results = server.MatchDocuments(query, document_ids);
+        const auto par_results = server.MatchDocuments(std::execution::par, query, document_ids);
+        ASSERT_EQUAL(results.size(), document_ids.size());
+        ASSERT(par_results == results);
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            ASSERT(results[i] == server.MatchDocument(query, document_ids[i]));
+        }
+    }
+    const auto results = server.MatchDocuments("curly nasty -tail"s, document_ids);
+    ASSERT(std::get<0>(results[0]) == std::vector<std::string_view>({ "nasty" }));
+    ASSERT(std::get<1>(results[0]) == DocumentStatus::IRRELEVANT);
+    ASSERT(std::get<0>(results[2]).empty());
+    ASSERT(std::get<0>(results[3]) == std::vector<std::string_view>({ "curly" }));
+    ASSERT(server.MatchDocuments("cat"s, {}).empty());
+    try {
+        server.MatchDocuments("cat"s, { 1, 5 });
+        ASSERT_HINT(false, "Unknown document id must throw"s);
+    }
+    catch (const std::out_of_range&) {
+    }
+}
+
+//    ,    ,      
+void TestCompiledQuery() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+    server.AddDocument(3, "nasty rat with curly tail"s, DocumentStatus::ACTUAL, { 3 });
+    server.AddDocument(4, "very nasty cat"s, DocumentStatus::ACTUAL, { 5 });
+    const std::string text = "curly nasty pet -cat"s;
+    const SearchServer::CompiledQuery query = server.CompileQuery(text);
+    ASSERT_EQUAL(query.GetText(), text);
+    const auto check_found = [](const std::vector<Document>& found, const std::vector<Document>& right_result) {
+        ASSERT_EQUAL(found.size(), right_result.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, right_result[i].id);
+            ASSERT_EQUAL(found[i].relevance, right_result[i].relevance);
+            ASSERT_EQUAL(found[i].rating, right_result[i].rating);
+        }
+    };
+    const auto check_all = [&](const SearchServer& other) {
+        check_found(other.FindTopDocuments(query), other.FindTopDocuments(text));
+        check_found(other.FindTopDocuments(query, DocumentStatus::BANNED), other.FindTopDocuments(text, DocumentStatus::BANNED));
+        check_found(other.FindTopDocuments(std::execution::par, query), other.FindTopDocuments(std::execution::par, text));
+        const auto is_odd = [](int id, DocumentStatus status, int rating) {
+            return id % 2 == 1;
+        };
+        check_found(other.FindTopDocuments(query, is_odd), other.FindTopDocuments(text, is_odd));
+        check_found(other.FindTopDocuments(std::execution::par, query, is_odd, 1), other.FindTopDocuments(std::execution::par, text, is_odd, 1));
+        std::vector<int> document_ids(other.begin(), other.end());
+        ASSERT(other.MatchDocuments(query, document_ids) == other.MatchDocuments(text, document_ids));
+        ASSERT(other.MatchDocuments(std::execution::par, query, document_ids) == other.MatchDocuments(text, document_ids));
+        for (const int id : document_ids) {
+            ASSERT(other.MatchDocument(query, id) == other.MatchDocument(text, id));
+        }
+    };
+    check_all(server);
+    //    IDF  
+    server.AddDocument(5, "curly pet"s, DocumentStatus::ACTUAL, { 1 });
+    check_all(server);
+    //     ,   
+    server.RemoveDocument(3);
+    server.PurgeRemovedDocuments();
+    check_all(server);
+    // ,   
+    SearchServer other("and with"s);
+    other.AddDocument(7, "curly pet"s, DocumentStatus::ACTUAL, { 2 });
+    other.AddDocument(8, "nasty cat"s, DocumentStatus::ACTUAL, { 2 });
+    check_all(other);
+    try {
+        server.CompileQuery("curly --pet"s);
+        ASSERT_HINT(false, "Invalid query must throw"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+}
+
 //  TestSearchServer      
 void TestSearchServer() {
     RUN_TEST(TestCreateServer);
@@ -261,4 +1292,30 @@ void TestSearchServer() {
     RUN_TEST(TestFilterPredicate);
     RUN_TEST(TestSearchDocumentsByStatus);
     RUN_TEST(TestCorrectCalculationRelevation);
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestMaxDocumentCount);
+    RUN_TEST(TestParallelSearch);
+    RUN_TEST(TestConcurrentMap);
+    RUN_TEST(TestRelevanceAfterCorpusChange);
+    RUN_TEST(TestDocumentTermIds);
+    RUN_TEST(TestWordStorageCompaction);
+    RUN_TEST(TestAddDocuments);
+    RUN_TEST(TestSnapshot);
+    RUN_TEST(TestFindTopDocumentsBatch);
+    RUN_TEST(TestProcessQueriesJoined);
+    RUN_TEST(TestPostingList);
+    RUN_TEST(TestSplitIntoValidWords);
+    RUN_TEST(TestMaxScoreMatchesFullScoring);
+    RUN_TEST(TestStatusAfterOrdinalReuse);
+    RUN_TEST(TestDocumentMetadataAfterOrdinalReuse);
+    RUN_TEST(TestPurgeRemovedDocuments);
+    RUN_TEST(TestConcurrentReadersAndWriter);
+    RUN_TEST(TestConcurrentWriteFailure);
+    RUN_TEST(TestSegmentedIndex);
+    RUN_TEST(TestQueryResultCache);
+    RUN_TEST(TestQueryWithoutAllocations);
+    RUN_TEST(TestFindDuplicates);
+    RUN_TEST(TestWordFrequencies);
+    RUN_TEST(TestMatchDocumentsBatch);
+    RUN_TEST(TestCompiledQuery);
 }
\ No newline at end of file
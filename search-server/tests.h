@@ -30,5 +30,83 @@ void TestSearchDocumentsByStatus();
 //  
 void TestCorrectCalculationRelevation();
 
+//   
+void TestRemoveDocument();
+
+//      
+void TestMaxDocumentCount();
+
+//    ,   
+void TestParallelSearch();
+
+//      
+void TestConcurrentMap();
+
+//IDF      
+void TestRelevanceAfterCorpusChange();
+
+//     
+void TestDocumentTermIds();
+
+//     ,   
+void TestWordStorageCompaction();
+
+//      ,     
+void TestAddDocuments();
+
+//,   ,     ,  
+void TestSnapshot();
+
+//     ,      
+void TestFindTopDocumentsBatch();
+
+//        
+void TestProcessQueriesJoined();
+
+//          
+void TestPostingList();
+
+//        
+void TestSplitIntoValidWords();
+
+//      
+void TestMaxScoreMatchesFullScoring();
+
+//       
+void TestStatusAfterOrdinalReuse();
+
+//  ,   
+void TestDocumentMetadataAfterOrdinalReuse();
+
+//        
+void TestPurgeRemovedDocuments();
+
+//       
+void TestConcurrentReadersAndWriter();
+
+//,   ,     
+void TestConcurrentWriteFailure();
+
+//,    ,        
+void TestSegmentedIndex();
+
+//   ,     
+void TestQueryResultCache();
+
+//         
+void TestQueryWithoutAllocations();
+
+//      ,   -   
+void TestFindDuplicates();
+
+//       
+void TestWordFrequencies();
+
+//       
+void TestMatchDocumentsBatch();
+
+//    ,    ,      
+void TestCompiledQuery();
+
 //  TestSearchServer      
 void TestSearchServer();
\ No newline at end of file
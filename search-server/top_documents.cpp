@@ -0,0 +1,63 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+bool IsBetterDocument(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EQUAL_MAX_DIFFERENCE) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+TopDocuments::TopDocuments(size_t max_count)
+    : max_count_(max_count)
+{
+    heap_.reserve(max_count_);
+}
+
+void TopDocuments::Reset(size_t max_count) {
+    max_count_ = max_count;
+    heap_.clear();
+    heap_.reserve(max_count_);
+}
+
+void TopDocuments::Add(const Document& document) {
+    if (heap_.size() < max_count_) {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    }
+    else if (max_count_ > 0 && IsBetterDocument(document, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+        heap_.back() = document;
+        std::push_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    }
+}
+
+void TopDocuments::Merge(const TopDocuments& other) {
+    for (const Document& document : other.heap_) {
+        Add(document);
+    }
+}
+
+double TopDocuments::GetMinRelevance() const {
+    if (max_count_ == 0 || heap_.size() < max_count_) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return heap_.front().relevance;
+}
+
+std::vector<Document> TopDocuments::Extract() {
+    std::sort_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    return std::move(heap_);
+}
+
+void TopDocuments::Extract(std::vector<Document>& documents) {
+    std::sort_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    documents.assign(heap_.begin(), heap_.end());
+    heap_.clear();
+}
\ No newline at end of file
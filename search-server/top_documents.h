@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+
+#include "document.h"
+
+static const double EQUAL_MAX_DIFFERENCE = 1e-6;
+
+// Ranking order of search results: relevance, then rating, then id
+bool IsBetterDocument(const Document& lhs, const Document& rhs);
+
+// Bounded selection of the best documents: a heap with the worst kept document on top
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t max_count);
+
+    // Starts a new selection, the memory is kept
+    void Reset(size_t max_count);
+
+    void Add(const Document& document);
+
+    void Merge(const TopDocuments& other);
+
+    // Relevance of the worst kept document once max_count are kept, -infinity before that
+    double GetMinRelevance() const;
+
+    // Best document first
+    std::vector<Document> Extract();
+
+    // Replaces the contents of documents with the selection, best first, and empties the
+    // selection. The memory of both is kept
+    void Extract(std::vector<Document>& documents);
+
+private:
+    size_t max_count_;
+    std::vector<Document> heap_;
+};
\ No newline at end of file